@@ -0,0 +1,381 @@
+/* Microbenchmark suite for curves and fuzzy sets.
+Usage: benchmark [output.json] [min_seconds]
+Results are written as JSON (to stdout when no file is given), progress goes
+to stderr. Must be run from the repository root, next to the shipped
+'temperature_*.json' models. */
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+#include "../include/json.hpp"
+#include "../include/curves.h"
+#include "../include/fuzzy.h"
+#include "../include/compiled.h"
+#include "../include/variant_set.h"
+#include "../include/variable.h"
+#include "../include/thread_pool.h"
+#include "../include/binary_model.h"
+#include "../include/plot_export.h"
+#include "../include/render.h"
+#include "../include/instrument.h"
+#include "../include/temperature_sets.hpp"
+
+using json = nlohmann::json;
+
+typedef struct result
+{
+    std::string name;
+    double ns_per_op;
+    std::size_t operations;
+} Result;
+
+double min_seconds = 0.2;
+std::vector<Result> results;
+
+// Sink for computed values, keeps the optimizer from dropping the work
+volatile double sink = 0;
+
+/* Calls 'run' (which performs 'operations' operations per call) with a
+doubling repeat count until it takes at least 'min_seconds'. */
+void measure(
+    std::string name, std::size_t operations, std::function<void()> run
+)
+{
+    typedef std::chrono::steady_clock Clock;
+    std::size_t repeats = 1;
+    while (true)
+    {
+        auto start = Clock::now();
+        for (std::size_t i = 0; i < repeats; i++) run();
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+        if (elapsed.count() >= min_seconds || repeats >= (1ull << 40))
+        {
+            std::size_t total = repeats * operations;
+            results.push_back({name, elapsed.count() * 1e9 / total, total});
+            std::cerr << name << ": " << results.back().ns_per_op
+                << " ns/op" << std::endl;
+            return;
+        }
+        repeats *= 2;
+    }
+}
+
+template <class Evaluate>
+void measure_scalar(
+    std::string name, const std::vector<double> &input, Evaluate evaluate
+)
+{
+    measure(name, input.size(), [&]()
+    {
+        double sum = 0;
+        for (double x: input) sum += evaluate(x);
+        sink = sum;
+    });
+}
+
+void measure_batch(
+    std::string name, const std::vector<double> &input,
+    std::function<void(const double*, double*, std::size_t)> evaluate
+)
+{
+    std::vector<double> output(input.size());
+    measure(name, input.size(), [&]()
+    {
+        evaluate(input.data(), output.data(), input.size());
+        sink = output[output.size() / 2];
+    });
+}
+
+std::vector<double> uniform(double from, double to, std::size_t count)
+{
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> distribution(from, to);
+    std::vector<double> values(count);
+    for (double &x: values) x = distribution(generator);
+    return values;
+}
+
+void benchmark_curves(void)
+{
+    std::vector<double> input = uniform(1, 10, 1 << 16);
+    std::vector<Curve*> curves = {
+        new ConstantCurve(0, 10, 0.5),
+        new LinearCurve(0, 10, 0.1, 0),
+        new QuadraticCurve(0, 10, -0.01, 0.1, 0.5),
+        new ExponentialCurve(0, 10, 1.2, 10, 0),
+        new LogarithmicCurve(0, 10, 11, 0, 0)
+    };
+    for (Curve *c: curves)
+    {
+        std::string name = c->get_json().begin().key();
+        measure_scalar("curve/" + name + "/scalar", input,
+            [c](double x) {return c->membership(x);});
+        measure_batch("curve/" + name + "/batch", input,
+            [c](const double *in, double *out, std::size_t n)
+            {
+                c->membership(in, out, n);
+            });
+        delete c;
+    }
+}
+
+void benchmark_segments(void)
+{
+    // Contiguous linear segments [i, i + 1) covering [0, segments)
+    for (std::size_t segments: {1, 4, 16, 64, 256, 1024})
+    {
+        std::vector<Curve*> curves;
+        for (std::size_t i = 0; i < segments; i++)
+            curves.push_back(
+                new LinearCurve(i, i + 1.0, 0.5, 0.1, true, false)
+            );
+        FuzzySet set("segments", curves);
+        CompiledFuzzySet compiled(set);
+        std::vector<double> input = uniform(0, segments, 1 << 16);
+        std::string suffix = "/" + std::to_string(segments);
+        measure_scalar("set/membership" + suffix, input,
+            [&set](double x) {return set.membership(x);});
+        measure_batch("set/membership_batch" + suffix, input,
+            [&set](const double *in, double *out, std::size_t n)
+            {
+                set.membership(in, out, n);
+            });
+        measure_scalar("compiled/membership" + suffix, input,
+            [&compiled](double x) {return compiled.membership(x);});
+    }
+}
+
+void benchmark_representations(std::vector<FuzzySet> &sets)
+{
+    std::vector<double> input = uniform(-30, 50, 1 << 16);
+    std::vector<VariantFuzzySet> variants;
+    std::vector<CompiledFuzzySet> compiled;
+    std::vector<FuzzySet> tabulated = sets;
+    for (FuzzySet &set: sets) variants.push_back(VariantFuzzySet(set));
+    for (FuzzySet &set: sets) compiled.push_back(CompiledFuzzySet(set));
+    for (FuzzySet &set: tabulated) set.enable_lut(1e-4);
+
+    for (std::size_t i = 0; i < sets.size(); i++)
+    {
+        std::string suffix = "/" + sets[i].get_name();
+        measure_scalar("temperature/pointer" + suffix, input,
+            [&](double x) {return sets[i].membership(x);});
+        measure_scalar("temperature/variant" + suffix, input,
+            [&](double x) {return variants[i].membership(x);});
+        measure_scalar("temperature/compiled" + suffix, input,
+            [&](double x) {return compiled[i].membership(x);});
+        measure_scalar("temperature/lut_1e-4" + suffix, input,
+            [&](double x) {return tabulated[i].membership(x);});
+    }
+
+    // All sets at once, one lookup per set against one merged lookup
+    LinguisticVariable variable("temperature", sets);
+    std::vector<double> memberships(sets.size());
+    measure_scalar("temperature/all/pointer", input, [&](double x)
+    {
+        double sum = 0;
+        for (FuzzySet &set: sets) sum += set.membership(x);
+        return sum;
+    });
+    measure_scalar("temperature/all/variable", input, [&](double x)
+    {
+        variable.membership(x, memberships.data());
+        double sum = 0;
+        for (double m: memberships) sum += m;
+        return sum;
+    });
+
+    using namespace temperature;
+    auto measure_static = [&input](std::string name, const auto &set)
+    {
+        measure_scalar("temperature/static/" + name, input,
+            [&set](double x) {return set.membership(x);});
+    };
+    measure_static("Freezing", Freezing);
+    measure_static("Cold", Cold);
+    measure_static("Warm", Warm);
+    measure_static("OK", OK);
+    measure_static("Hot", Hot);
+}
+
+/* Scaling of pooled batch evaluation from 1 thread to all hardware threads.
+Inputs are sorted so chunks differ in cost - the ones falling into the
+exponential and logarithmic segments are much slower than the constant
+ones, which is what work stealing evens out. */
+void benchmark_threads(std::vector<FuzzySet> &sets)
+{
+    std::vector<double> input = uniform(-30, 50, 1 << 22);
+    std::sort(input.begin(), input.end());
+    std::vector<double> output(input.size() * sets.size());
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> counts;
+    for (unsigned t = 1; t < cores; t *= 2) counts.push_back(t);
+    counts.push_back(cores);
+    for (unsigned threads: counts)
+    {
+        ThreadPool pool(threads);
+        measure("threads/membership/" + std::to_string(threads),
+            input.size() * sets.size(), [&]()
+            {
+                parallel_membership(
+                    pool, sets, input.data(), input.size(), output.data()
+                );
+                sink = output[output.size() / 2];
+            });
+    }
+}
+
+// Scratch file of the benchmark in the temporary directory
+std::string temporary(const std::string &name)
+{
+    return (std::filesystem::temp_directory_path()
+        / ("fuzzy_benchmark_" + name)).string();
+}
+
+void benchmark_io(std::vector<std::string> filenames)
+{
+    for (std::string filename: filenames)
+        measure("load/" + filename, 1, [filename]()
+        {
+            sink = load_fuzzy_sets(filename).size();
+        });
+
+    std::vector<FuzzySet> sets;
+    for (std::string filename: filenames)
+        for (FuzzySet &set: load_fuzzy_sets(filename)) sets.push_back(set);
+
+    // Same models in the binary format, read back and opened in place
+    const std::string binary_file = temporary("model.fzb");
+    save_binary_model(sets, binary_file);
+    measure("load_binary", 1, [&binary_file]()
+    {
+        sink = load_binary_model(binary_file).size();
+    });
+    measure("open_binary", 1, [&binary_file]()
+    {
+        sink = BinaryModel(binary_file).size();
+    });
+    std::remove(binary_file.c_str());
+
+    measure("get_json", sets.size(), [&sets]()
+    {
+        std::size_t size = 0;
+        for (FuzzySet &set: sets) size += set.get_json().size();
+        sink = size;
+    });
+
+    const std::string plot_file = temporary("plot.csv");
+    measure("generate_plot_data", sets.size(), [&sets, &plot_file]()
+    {
+        for (FuzzySet &set: sets) set.generate_plot_data(plot_file);
+    });
+    // Zero tolerance samples every curve at the full 300 cells
+    measure("generate_plot_data/fixed", sets.size(), [&sets, &plot_file]()
+    {
+        for (FuzzySet &set: sets)
+            set.generate_plot_data(plot_file, 300, 0, 10, 0);
+    });
+    std::remove(plot_file.c_str());
+    const std::string npy_file = temporary("plot.npy");
+    measure("generate_plot_data/npy", sets.size(), [&sets, &npy_file]()
+    {
+        for (FuzzySet &set: sets) set.generate_plot_data(npy_file);
+    });
+    std::remove(npy_file.c_str());
+
+    for (std::string format: {"svg", "png"})
+    {
+        const std::string render_file = temporary("plot." + format);
+        measure("render/" + format, 1, [&sets, &render_file]()
+        {
+            render_plot(sets, render_file);
+        });
+        std::remove(render_file.c_str());
+    }
+}
+
+/* Plot export of a model with many sets, one file per set against a
+single long-format file, on all hardware threads. */
+void benchmark_export(std::vector<FuzzySet> &sets)
+{
+    std::vector<FuzzySet> model;
+    for (int copy = 0; copy < 200; copy++)
+        for (FuzzySet &set: sets)
+            model.push_back(FuzzySet(
+                set.get_name() + std::to_string(copy),
+                set.get_json().begin().value()
+            ));
+    ThreadPool pool;
+    const std::string directory = temporary("export");
+    std::filesystem::create_directory(directory);
+    measure("export/files", model.size(), [&]()
+    {
+        export_plot_data(pool, model, directory + "/");
+    });
+    measure("export/combined", model.size(), [&]()
+    {
+        export_combined_plot_data(pool, model, directory + "/all.csv");
+    });
+    std::filesystem::remove_all(directory);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 2) min_seconds = std::atof(argv[2]);
+    std::vector<std::string> filenames = {
+        "temperature_low.json", "temperature_high.json"
+    };
+    std::vector<FuzzySet> sets;
+    try
+    {
+        for (std::string filename: filenames)
+            for (FuzzySet &set: load_fuzzy_sets(filename))
+                sets.push_back(std::move(set));
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    benchmark_curves();
+    benchmark_segments();
+    benchmark_representations(sets);
+    benchmark_threads(sets);
+    benchmark_io(filenames);
+    benchmark_export(sets);
+
+    json report = {{"min_seconds", min_seconds}, {"benchmarks", json::array()}};
+    for (Result &r: results)
+    {
+        report["benchmarks"].push_back({
+            {"name", r.name},
+            {"ns_per_op", r.ns_per_op},
+            {"ops_per_sec", 1e9 / r.ns_per_op},
+            {"operations", r.operations}
+        });
+    }
+    // Only '{"enabled": false}' unless built with FUZZY_INSTRUMENT
+    report["instrumentation"] = instrumentation_report(sets);
+    if (argc > 1)
+    {
+        std::ofstream output_file(argv[1], std::ios::trunc);
+        if (!output_file.good())
+        {
+            std::cerr << "File " << argv[1] << " can't be oppened!\n";
+            return 1;
+        }
+        output_file << report.dump(4) << std::endl;
+    }
+    else std::cout << report.dump(4) << std::endl;
+    return 0;
+}
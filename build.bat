@@ -7,4 +7,29 @@ SET main_folder_path=D:\vs\predmety\14PAM\programovani\paper
 @REM Assemble compiler invocation...
 SET envocation=%compiler_path% -g %main_folder_path%\include\*.cpp %main_folder_path%\main.cpp -o %main_folder_path%\main.exe
 
-call %envocation%
\ No newline at end of file
+call %envocation%
+
+@REM Benchmark is built optimized, timings of a debug build are meaningless
+SET bench_envocation=%compiler_path% -O2 -flto %main_folder_path%\include\*.cpp %main_folder_path%\bench\benchmark.cpp -o %main_folder_path%\benchmark.exe
+
+call %bench_envocation%
+
+@REM Code generator for specialized evaluation headers
+SET codegen_envocation=%compiler_path% -O2 %main_folder_path%\include\*.cpp %main_folder_path%\tools\codegen.cpp -o %main_folder_path%\codegen.exe
+
+call %codegen_envocation%
+@REM Regression tests, run from the repository root, they include headers
+@REM generated from the shipped models
+mkdir %main_folder_path%\generated
+pushd %main_folder_path%
+for %%m in (temperature_low temperature_high tests\codegen_cases) do (
+    call %main_folder_path%\codegen.exe %%m.json generated\%%~nm.hpp generated
+    call %main_folder_path%\codegen.exe --fast %%m.json generated\%%~nm_fast.hpp generated_fast
+)
+popd
+SET tests_envocation=%compiler_path% -O2 -I%main_folder_path%\generated %main_folder_path%\include\*.cpp %main_folder_path%\tests\tests.cpp -o %main_folder_path%\tests.exe
+
+call %tests_envocation%
+SET allocation_tests_envocation=%compiler_path% -O2 %main_folder_path%\include\*.cpp %main_folder_path%\tests\allocations.cpp -o %main_folder_path%\allocation_tests.exe
+
+call %allocation_tests_envocation%
\ No newline at end of file
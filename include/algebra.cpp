@@ -0,0 +1,478 @@
+#include "algebra.h"
+#include <cmath>
+#include <math.h>
+#include <limits>
+#include <algorithm>
+#include <vector>
+#include <iterator>
+#include <functional>
+
+typedef struct piece
+{
+    double from, to;
+    bool lower_inclusive, upper_inclusive;
+    CurveType type;
+    std::vector<double> parameters;
+} Piece;
+
+const double infinity = std::numeric_limits<double>::infinity();
+
+// Maps t from [0, 1] monotonically onto the interval, infinite ends too
+static double interval_point(double from, double to, double t)
+{
+    if (std::isinf(from) && std::isinf(to)) return (t - 0.5) / (t * (1 - t));
+    if (std::isinf(from)) return to - (1 - t) / t;
+    if (std::isinf(to)) return from + t / (1 - t);
+    return from + t * (to - from);
+}
+
+// Curve of the set on the piece containing 'value', NULL outside all curves
+static const Curve *owner_curve(const FuzzySet &set, double value)
+{
+    int i = set.get_index().find(value);
+    return i < 0 ? NULL : set.get_curves()[i];
+}
+
+static double curve_value(const Curve *curve, double value)
+{
+    return curve ? curve->membership(value) : 0;
+}
+
+// Coefficients of a*x^2 + b*x + c, false for non-polynomial curves
+static bool polynomial(const Curve *curve, double k[3])
+{
+    k[0] = k[1] = k[2] = 0;
+    if (!curve) return true;
+    std::vector<double> p = curve->get_parameters();
+    switch (curve->get_type())
+    {
+        case CurveType::Constant: k[2] = p[0]; return true;
+        case CurveType::Linear: k[1] = p[0]; k[2] = p[1]; return true;
+        case CurveType::Quadratic:
+            k[0] = p[0]; k[1] = p[1]; k[2] = p[2]; return true;
+        default: return false;
+    }
+}
+
+static bool same_curve(const Curve *a, const Curve *b)
+{
+    if (!a || !b) return a == b;
+    return a->get_type() == b->get_type()
+        && a->get_parameters() == b->get_parameters();
+}
+
+/* Difference of two curves as a quadratic polynomial plus exponential
+terms 'coefficient * e^(rate * (x - offset))' and logarithmic terms
+'coefficient * ln(x - offset)'. */
+typedef struct term
+{
+    double coefficient, rate, offset;
+} Term;
+
+typedef struct difference
+{
+    double k[3] = {0, 0, 0};
+    std::vector<Term> exponentials, logarithms;
+} Difference;
+
+// Adds 'sign' times the curve to 'd', NULL adds nothing
+static void add_term(Difference &d, const Curve *curve, double sign)
+{
+    double k[3];
+    if (polynomial(curve, k))
+    {
+        for (int i = 0; i < 3; i++) d.k[i] += sign * k[i];
+        return;
+    }
+    std::vector<double> p = curve->get_parameters();
+    // base, x_offset, y_offset (, scale)
+    d.k[2] += sign * p[2];
+    if (curve->get_type() == CurveType::Exponential)
+        d.exponentials.push_back({sign * p[3], log(p[0]), p[1]});
+    else d.logarithms.push_back({sign / log(p[0]), 0, p[1]});
+}
+
+// Derivative of order 'n' >= 1 of 'd' at 'x'
+static double derivative(const Difference &d, int n, double x)
+{
+    double sum = 0;
+    if (n == 1) sum = 2 * d.k[0] * x + d.k[1];
+    if (n == 2) sum = 2 * d.k[0];
+    for (const Term &t: d.exponentials)
+        sum += t.coefficient * pow(t.rate, n) * exp(t.rate * (x - t.offset));
+    // n-th derivative of ln(u) is (-1)^(n - 1) * (n - 1)! / u^n
+    double factorial = 1;
+    for (int i = 2; i < n; i++) factorial *= i;
+    for (const Term &t: d.logarithms)
+        sum += (n % 2 ? 1 : -1) * t.coefficient * factorial
+            / pow(x - t.offset, n);
+    return sum;
+}
+
+/* Last point of steps from 'x' in 'direction' (doubling every time) before
+'f' changes its sign from the one at 'x', or the point where it does. Used
+for infinite ends of intervals where 'f' is monotone, so the sign of its
+limit shows unless the crossing is too far out to be represented. */
+static double outward_point(
+    const std::function<double(double)> &f, double x, double direction
+)
+{
+    const double start = f(x);
+    double step = std::max(1.0, fabs(x));
+    double last = x;
+    while (true)
+    {
+        const double next = x + direction * step;
+        const double value = f(next);
+        if (std::isinf(next) || value != value) return last;
+        if (value == 0 || (value < 0) != (start < 0)) return next;
+        last = next;
+        step *= 2;
+    }
+}
+
+/* Points inside (from, to) where 'f' changes sign or is zero, sorted. 'f'
+must be monotone between the sorted 'splits', so every piece between them
+holds one sign change at most, which is bisected to full precision.
+Infinite ends are bracketed by 'outward_point'. */
+static std::vector<double> monotone_roots(
+    const std::function<double(double)> &f,
+    const std::vector<double> &splits, double from, double to
+)
+{
+    std::vector<double> points = {from};
+    for (double x: splits)
+        if (from < x && x < to && x > points.back()) points.push_back(x);
+    // Any point splits a monotone function into monotone pieces
+    if (points.size() == 1 && std::isinf(from) && std::isinf(to))
+        points.push_back(0);
+    points.push_back(to);
+
+    std::vector<double> roots;
+    for (std::size_t i = 0; i + 1 < points.size(); i++)
+    {
+        double low = points[i], high = points[i + 1];
+        // Singular ends (a logarithm at its offset) give way to a neighbour
+        if (std::isfinite(low) && f(low) != f(low))
+            low = std::nextafter(low, high);
+        if (std::isfinite(high) && f(high) != f(high))
+            high = std::nextafter(high, low);
+        if (std::isinf(low)) low = outward_point(f, high, -1);
+        if (std::isinf(high)) high = outward_point(f, low, 1);
+        double d_low = f(low);
+        const double d_high = f(high);
+        if (d_low == 0) roots.push_back(low);
+        if (d_high == 0) roots.push_back(high);
+        if (!((d_low < 0 && d_high > 0) || (d_low > 0 && d_high < 0)))
+            continue;
+        while (true)
+        {
+            const double middle = 0.5 * (low + high);
+            if (middle <= low || middle >= high) break;
+            const double d_middle = f(middle);
+            if (d_middle != d_middle) break;
+            if (d_middle == 0) low = high = middle;
+            else if ((d_middle < 0) == (d_low < 0))
+            {
+                low = middle; d_low = d_middle;
+            }
+            else high = middle;
+        }
+        roots.push_back(0.5 * (low + high));
+    }
+    std::sort(roots.begin(), roots.end());
+    roots.erase(std::unique(roots.begin(), roots.end()), roots.end());
+    return roots;
+}
+
+/* Points splitting (from, to) into pieces where 'd' is monotone, that is
+the zeros of its derivative. With one exponential or logarithm the third
+derivative keeps its sign, so the zeros of the second one split the first
+into monotone pieces. Two exponentials or two logarithms have at most one
+zero of the derivative in closed form. For an exponential and a logarithm
+(x - offset) * d' has a derivative vanishing only at offset - 1 / rate. */
+static std::vector<double> monotone_splits(
+    const Difference &d, double from, double to
+)
+{
+    auto first = [&d](double x) {return derivative(d, 1, x);};
+    auto second = [&d](double x) {return derivative(d, 2, x);};
+    const std::vector<Term> &e = d.exponentials, &l = d.logarithms;
+    std::vector<double> splits;
+    if (e.size() + l.size() == 1)
+        return monotone_roots(
+            first, monotone_roots(second, {}, from, to), from, to
+        );
+    if (e.size() == 2)
+    {
+        // c0 r0 e^(r0 (x - o0)) = -c1 r1 e^(r1 (x - o1))
+        const double ratio = -(e[1].coefficient * e[1].rate)
+            / (e[0].coefficient * e[0].rate);
+        if (ratio > 0 && e[0].rate != e[1].rate)
+            splits.push_back(
+                (log(ratio) + e[0].rate * e[0].offset
+                    - e[1].rate * e[1].offset) / (e[0].rate - e[1].rate)
+            );
+    }
+    else if (l.size() == 2)
+    {
+        // c0 / (x - o0) = -c1 / (x - o1)
+        const double sum = l[0].coefficient + l[1].coefficient;
+        if (sum != 0)
+            splits.push_back((l[0].coefficient * l[1].offset
+                + l[1].coefficient * l[0].offset) / sum);
+    }
+    else if (e.size() == 1 && l.size() == 1)
+    {
+        const Term &t = l[0];
+        auto scaled = [&first, &t](double x)
+        {
+            return (x - t.offset) * first(x);
+        };
+        splits = monotone_roots(
+            scaled, {t.offset - 1 / e[0].rate}, from, to
+        );
+    }
+    return splits;
+}
+
+/* Points strictly inside (from, to) where curves 'a' and 'b' cross, sorted.
+Polynomial pairs, and an exponential or a logarithm against a constant, are
+solved exactly. Otherwise the interval is split where the difference of the
+curves is stationary (see 'monotone_splits') and each monotone piece is
+bisected to full precision where it changes sign. Points where the curves
+only touch may be missed, the winning curve does not change there. */
+static std::vector<double> crossovers(
+    const Curve *a, const Curve *b, double from, double to
+)
+{
+    std::vector<double> roots;
+    double ka[3], kb[3];
+    if (polynomial(a, ka) && polynomial(b, kb))
+    {
+        const double qa = ka[0] - kb[0], qb = ka[1] - kb[1];
+        const double qc = ka[2] - kb[2];
+        if (qa == 0)
+        {
+            if (qb != 0) roots.push_back(-qc / qb);
+        }
+        else
+        {
+            const double discriminant = qb * qb - 4 * qa * qc;
+            if (discriminant >= 0)
+            {
+                // Form without cancellation between 'qb' and the root
+                const double q =
+                    -0.5 * (qb + std::copysign(std::sqrt(discriminant), qb));
+                roots.push_back(q / qa);
+                if (q != 0) roots.push_back(qc / q);
+            }
+        }
+    }
+    else if (!same_curve(a, b))
+    {
+        Difference d;
+        add_term(d, a, 1);
+        add_term(d, b, -1);
+        const std::vector<Term> &e = d.exponentials, &l = d.logarithms;
+        if (d.k[0] == 0 && d.k[1] == 0 && e.size() + l.size() == 1)
+        {
+            // c e^(r (x - o)) + k = 0 or c ln(x - o) + k = 0
+            if (e.size() && -d.k[2] / e[0].coefficient > 0)
+                roots.push_back(e[0].offset
+                    + log(-d.k[2] / e[0].coefficient) / e[0].rate);
+            if (l.size())
+                roots.push_back(
+                    l[0].offset + exp(-d.k[2] / l[0].coefficient)
+                );
+        }
+        else
+        {
+            auto value = [a, b](double x)
+            {
+                return curve_value(a, x) - curve_value(b, x);
+            };
+            roots = monotone_roots(
+                value, monotone_splits(d, from, to), from, to
+            );
+        }
+    }
+
+    roots.erase(
+        std::remove_if(roots.begin(), roots.end(),
+            [from, to](double x) {return !(from < x && x < to);}),
+        roots.end()
+    );
+    std::sort(roots.begin(), roots.end());
+    roots.erase(std::unique(roots.begin(), roots.end()), roots.end());
+    return roots;
+}
+
+// Piece of given bounds following 'curve', constant 'outside' for NULL
+static Piece make_piece(
+    double from, double to, bool lower_inclusive, bool upper_inclusive,
+    const Curve *curve, double outside = 0
+)
+{
+    if (!curve)
+        return {from, to, lower_inclusive, upper_inclusive,
+            CurveType::Constant, {outside}};
+    return {from, to, lower_inclusive, upper_inclusive,
+        curve->get_type(), curve->get_parameters()};
+}
+
+/* Joins neighbouring pieces that follow the same curve and builds the set.
+Pieces of constant zero are dropped, the set is zero outside its curves. */
+static FuzzySet assemble(std::string name, const std::vector<Piece> &pieces)
+{
+    std::vector<Curve*> curves;
+    auto emit = [&curves](const Piece &p)
+    {
+        if (p.type == CurveType::Constant && p.parameters[0] == 0) return;
+        curves.push_back(make_curve(
+            p.type, p.parameters, p.from, p.to,
+            p.lower_inclusive, p.upper_inclusive
+        ));
+    };
+    for (std::size_t i = 0; i < pieces.size(); i++)
+    {
+        Piece current = pieces[i];
+        while (i + 1 < pieces.size())
+        {
+            const Piece &next = pieces[i + 1];
+            bool adjacent = current.to == next.from
+                && (current.upper_inclusive || next.lower_inclusive);
+            if (!adjacent || current.type != next.type
+                || current.parameters != next.parameters) break;
+            current.to = next.to;
+            current.upper_inclusive = next.upper_inclusive;
+            i++;
+        }
+        emit(current);
+    }
+    return FuzzySet(name, curves);
+}
+
+static std::vector<double> merge_breakpoints(
+    const FuzzySet &a, const FuzzySet &b
+)
+{
+    const std::vector<double> &pa = a.get_index().get_breakpoints();
+    const std::vector<double> &pb = b.get_index().get_breakpoints();
+    std::vector<double> merged;
+    std::merge(pa.begin(), pa.end(), pb.begin(), pb.end(),
+        std::back_inserter(merged));
+    merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+    return merged;
+}
+
+static FuzzySet combine(
+    const FuzzySet &a, const FuzzySet &b, bool maximum, std::string name
+)
+{
+    auto wins = [maximum](double va, double vb)
+    {
+        return maximum ? va >= vb : va <= vb;
+    };
+    std::vector<double> breakpoints = merge_breakpoints(a, b);
+    std::vector<Piece> pieces;
+    const std::size_t k = breakpoints.size();
+    for (std::size_t i = 0; i <= k; i++)
+    {
+        // Open interval before breakpoint 'i', split at the crossovers
+        const double from = i > 0 ? breakpoints[i - 1] : -infinity;
+        const double to = i < k ? breakpoints[i] : infinity;
+        if (from < to)
+        {
+            const double middle = interval_point(from, to, 0.5);
+            const Curve *ca = owner_curve(a, middle);
+            const Curve *cb = owner_curve(b, middle);
+            std::vector<double> cuts = crossovers(ca, cb, from, to);
+            cuts.insert(cuts.begin(), from);
+            cuts.push_back(to);
+            for (std::size_t j = 0; j + 1 < cuts.size(); j++)
+            {
+                const double x = interval_point(cuts[j], cuts[j + 1], 0.5);
+                const Curve *winner =
+                    wins(curve_value(ca, x), curve_value(cb, x)) ? ca : cb;
+                // Crossover points go with the piece on their left
+                pieces.push_back(make_piece(
+                    cuts[j], cuts[j + 1], false, j + 2 < cuts.size(), winner
+                ));
+            }
+        }
+        if (i < k && std::isfinite(breakpoints[i]))
+        {
+            const double x = breakpoints[i];
+            const Curve *ca = owner_curve(a, x);
+            const Curve *cb = owner_curve(b, x);
+            const Curve *winner =
+                wins(curve_value(ca, x), curve_value(cb, x)) ? ca : cb;
+            pieces.push_back(make_piece(x, x, true, true, winner));
+        }
+    }
+    return assemble(name, pieces);
+}
+
+FuzzySet fuzzy_union(const FuzzySet &a, const FuzzySet &b, std::string name)
+{
+    if (name.empty()) name = a.get_name() + " OR " + b.get_name();
+    return combine(a, b, true, name);
+}
+
+FuzzySet fuzzy_intersection(
+    const FuzzySet &a, const FuzzySet &b, std::string name
+)
+{
+    if (name.empty()) name = a.get_name() + " AND " + b.get_name();
+    return combine(a, b, false, name);
+}
+
+// Piece following 1 - 'curve', of the same curve type
+static Piece complement_piece(
+    double from, double to, bool lower_inclusive, bool upper_inclusive,
+    const Curve *curve
+)
+{
+    Piece p = make_piece(
+        from, to, lower_inclusive, upper_inclusive, curve, 1
+    );
+    if (!curve) return p;
+    std::vector<double> &k = p.parameters;
+    switch (p.type)
+    {
+        case CurveType::Constant: k[0] = 1 - k[0]; break;
+        case CurveType::Linear: k[0] = -k[0]; k[1] = 1 - k[1]; break;
+        case CurveType::Quadratic:
+            k[0] = -k[0]; k[1] = -k[1]; k[2] = 1 - k[2]; break;
+        case CurveType::Exponential:
+            // 1 - (s * b^(x - x0) + y0) = -s * b^(x - x0) + (1 - y0)
+            k[2] = 1 - k[2]; k[3] = -k[3]; break;
+        case CurveType::Logarithmic:
+            // -log_b(x - x0) = log_(1/b)(x - x0)
+            k[0] = 1 / k[0]; k[2] = 1 - k[2]; break;
+    }
+    return p;
+}
+
+FuzzySet fuzzy_complement(const FuzzySet &a, std::string name)
+{
+    if (name.empty()) name = "NOT " + a.get_name();
+    const std::vector<double> &breakpoints = a.get_index().get_breakpoints();
+    std::vector<Piece> pieces;
+    const std::size_t k = breakpoints.size();
+    for (std::size_t i = 0; i <= k; i++)
+    {
+        const double from = i > 0 ? breakpoints[i - 1] : -infinity;
+        const double to = i < k ? breakpoints[i] : infinity;
+        if (from < to)
+            pieces.push_back(complement_piece(from, to, false, false,
+                owner_curve(a, interval_point(from, to, 0.5))));
+        if (i < k && std::isfinite(breakpoints[i]))
+            pieces.push_back(complement_piece(
+                breakpoints[i], breakpoints[i], true, true,
+                owner_curve(a, breakpoints[i])
+            ));
+    }
+    return assemble(name, pieces);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+
+#include "fuzzy.h"
+
+/* Standard fuzzy set operations (max, min and 1 - x) computed once into a
+new piecewise set instead of evaluating the operands on every call. The
+breakpoints of both operands are merged, inside every elementary interval
+the crossover points of the two curves are found - in closed form for
+polynomial curves and for an exponential or logarithm against a constant,
+otherwise by bisecting the pieces where their difference is monotone - and
+each resulting piece takes the winning curve. Adjacent pieces with the same
+curve are joined, pieces with zero membership are left out. Names default
+to "A OR B", "A AND B" and "NOT A". */
+FuzzySet fuzzy_union(
+    const FuzzySet &a, const FuzzySet &b, std::string name = ""
+);
+FuzzySet fuzzy_intersection(
+    const FuzzySet &a, const FuzzySet &b, std::string name = ""
+);
+FuzzySet fuzzy_complement(const FuzzySet &a, std::string name = "");
@@ -5,8 +5,13 @@
 #include <iostream>
 #include <cstdlib>
 #include <vector>
+#include <limits>
+#include <utility>
 #include "json.hpp"
 #include "curves.h"
+#include "binary_model.h"
+#include "plot_export.h"
+#include "render.h"
 
 void display(std::vector<std::string> choices)
 {
@@ -17,12 +22,39 @@ void display(std::vector<std::string> choices)
     }
 }
 
+void clear_screen(void)
+{
+#ifdef _WIN32
+    system("CLS");
+#else
+    system("clear");
+#endif
+}
+
+/* Drops the rest of the current input line, every read consumes its whole
+line so the next one starts on fresh input. */
+void skip_line(void)
+{
+    std::cin.clear();
+    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+}
+
+void wait_for_user(void)
+{
+#ifdef _WIN32
+    system("PAUSE");
+#else
+    std::cout << "Press Enter to continue..." << std::endl;
+    skip_line();
+#endif
+}
+
 void App::loop(void)
 {
     App_function_pointer command = _main_menu.back().command;
     while (_run)
     {
-        system("CLS");
+        clear_screen();
         try
         {
             command = _select(_main_menu);
@@ -31,11 +63,11 @@ void App::loop(void)
         {
             std::cerr << "Exception occured!" << std::endl;
             std::cerr << e.what() << std::endl;
-            system("PAUSE");
+            wait_for_user();
             continue;
         }
         (this->*command)();
-        if (_run) system("PAUSE");
+        if (_run) wait_for_user();
     }
 }
 
@@ -47,8 +79,9 @@ App::App_function_pointer App::_select(Menu menu)
     int choice;
     std::cout << "Choose option:" << std::endl;
     std::cin >> choice;
-    if (std::cin.fail())
-        throw std::invalid_argument("Input choice unrecognized!");
+    const bool failed = std::cin.fail();
+    skip_line();
+    if (failed) throw std::invalid_argument("Input choice unrecognized!");
     if (!(1 <= choice && choice <= choices.size()))
         throw std::invalid_argument("Chosen option out of range!");
     return menu[choice-1].command;
@@ -63,22 +96,18 @@ void App::_load_from_json(void)
 
 void App::_load_from_json(std::string filename)
 {
-    std::ifstream input_file(filename);
-    if (!input_file.good())
-    {
-        std::string message = "Failed to open file '" + filename + "'!";
-        throw std::invalid_argument(message);
-    }
     try
     {
-        json input_json = json::parse(input_file);
-        for (auto j: input_json) _sets.push_back(FuzzySet(j));
+        for (FuzzySet &set: is_binary_model(filename) ?
+            load_binary_model(filename) : load_fuzzy_sets(filename))
+            _sets.push_back(std::move(set));
     }
     catch(const std::exception& e)
     {
         std::cerr << "Loading from file '" + filename + "'failed!";
         std::cerr << e.what() << '\n';
     }
+    _compile();
 }
 
 void App::_create_new(void)
@@ -125,7 +154,7 @@ void App::_create_new(void)
         next_curve = ask_user<bool>("Next curve segment? [0/1 >> No/Yes]: ");
     }
     _sets.push_back(FuzzySet(json {{name, j_set}}));
-    
+    _compile();
 }
 
 void App::_evaluate(void)
@@ -143,22 +172,24 @@ void App::_evaluate(double value)
 {
     std::cout << "Evaluating membership functions for input value: "
         << value << std::endl;
-    for (FuzzySet set: _sets)
+    _variable.membership(value, _memberships.data());
+    for (std::size_t i = 0; i < _memberships.size(); i++)
         {
-            std::cout << "Set: '" << set.get_name() <<
-                "'\t membership: " << set.membership(value) << std::endl;
+            std::cout << "Set: '" << _sets[i].get_name() <<
+                "'\t membership: " << _memberships[i] << std::endl;
         }
 }
 
 void App::_delete(void)
 {
     std::vector<std::string> names;
-    for (FuzzySet set: _sets) names.push_back(set.get_name());
+    for (const FuzzySet &set: _sets) names.push_back(set.get_name());
     display(names);
     int choice = ask_user<int>("Select fuzzy set for deletion: ");
     if (!(1 <= choice && choice <= _sets.size()))
         throw std::invalid_argument("Selected index out of range!");
-    _sets.erase(_sets.begin() + choice);
+    _sets.erase(_sets.begin() + (choice - 1));
+    _compile();
 }
 
 void App::_save(void)
@@ -176,28 +207,45 @@ void App::_save(std::string filename)
         throw std::invalid_argument(message);
     }
     json j = json::array();
-    for (FuzzySet set: _sets) j.push_back(set.get_json());
+    for (const FuzzySet &set: _sets) j.push_back(set.get_json());
     output_file << j.dump(4) << std::endl;
 }
 
 void App::_plot(void)
 {
-    std::string command_invocation = "CALL plot\\plot.bat";
-    system("mkdir tmp");
-    for (FuzzySet set: _sets)
+    try
     {
-        std::string filename = "tmp\\" + set.get_name() + ".csv";
-        set.generate_plot_data(filename);
-        command_invocation += " " + filename;
+        std::string filename = ask_user<std::string>(
+            "Enter name of the plot file (.svg or .png): "
+        );
+        render_plot(_sets, filename);
+        std::cout << "Plot saved to '" << filename << "'." << std::endl;
     }
-    system(command_invocation.c_str());
-    system("rmdir tmp /s /q");
+    catch (std::exception &e) {std::cout << e.what() << std::endl;}
 }
 
 void App::_export_csv(void)
 {
-    for (FuzzySet set: _sets)
-    set.generate_plot_data("output\\" + set.get_name() + ".csv");
+    try
+    {
+        if (ask_user<bool>("Write all sets to one file? [0/1 >> No/Yes]: "))
+            export_combined_plot_data(_pool, _sets,
+                ask_user<std::string>("Enter name of the output file: "));
+        else
+        {
+            bool npy = ask_user<bool>(
+                "Write NumPy .npy files instead of CSV? [0/1 >> No/Yes]: "
+            );
+            export_plot_data(_pool, _sets, "output/", npy ? ".npy" : ".csv");
+        }
+    }
+    catch (std::exception &e) {std::cout << e.what() << std::endl;}
+}
+
+void App::_compile(void)
+{
+    _variable = LinguisticVariable("input", _sets);
+    _memberships.assign(_sets.size(), 0);
 }
 
 void App::_install_plotting(void)
@@ -4,6 +4,10 @@
 #include <string>
 #include <vector>
 #include "fuzzy.h"
+#include "variable.h"
+#include "thread_pool.h"
+
+void skip_line(void);
 
 template <class T>
 T ask_user(std::string prompt)
@@ -12,12 +16,15 @@ T ask_user(std::string prompt)
     std::cout << prompt;
     std::cin.clear();
     std::cin >> result;
-    if (std::cin.fail())
-        throw std::invalid_argument("Failed to convert input!");
+    const bool failed = std::cin.fail();
+    skip_line();
+    if (failed) throw std::invalid_argument("Failed to convert input!");
     return result;
 }
 
 void display(std::vector<std::string> choices);
+void clear_screen(void);
+void wait_for_user(void);
 
 class App
 {
@@ -49,10 +56,17 @@ class App
         void _install_plotting(void);
         void _uninstall_plotting(void);
         void _terminate(void) {_run = false;}
+        void _compile(void);
 
     private:
         bool _run = true;
         std::vector<FuzzySet> _sets;
+        // Evaluation form of '_sets', rebuilt by '_compile' on every change
+        LinguisticVariable _variable;
+        // Output of '_variable', sized by '_compile'
+        std::vector<double> _memberships;
+        // Threads exporting plot data, one per core
+        ThreadPool _pool;
         Menu _main_menu =
         {
             {"Load fuzzy set from JSON file", &App::_load_from_json},
@@ -0,0 +1,280 @@
+#include "binary_model.h"
+#include "compiled.h"
+#include "instrument.h"
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <memory>
+#include <utility>
+
+const std::size_t k_count = CompiledFuzzySet::coefficient_count;
+
+bool little_endian(void)
+{
+    const std::uint16_t probe = 1;
+    unsigned char first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+void save_binary_model(
+    const std::vector<FuzzySet> &sets, const std::string &filename
+)
+{
+    if (!little_endian())
+        throw std::runtime_error("Only little-endian machines write .fzb!");
+    std::vector<FzbSet> records;
+    std::vector<double> lower, upper, coefficients, breakpoints;
+    std::vector<std::int32_t> owners;
+    std::vector<unsigned char> types, flags;
+    std::string names;
+    for (const FuzzySet &set: sets)
+    {
+        const SegmentIndex &index = set.get_index();
+        const std::vector<const Curve*> &curves = set.get_curves();
+        FzbSet record;
+        record.name_offset = names.size();
+        record.name_length = set.get_name().size();
+        record.first_segment = lower.size();
+        record.segment_count = curves.size();
+        record.first_breakpoint = breakpoints.size();
+        record.breakpoint_count = index.get_breakpoints().size();
+        record.first_owner = owners.size();
+        records.push_back(record);
+
+        names += set.get_name();
+        for (const Curve *c: curves)
+        {
+            lower.push_back(c->get_lower_bound());
+            upper.push_back(c->get_upper_bound());
+            double k[k_count];
+            CompiledFuzzySet::get_coefficients(c, k);
+            coefficients.insert(coefficients.end(), k, k + k_count);
+            types.push_back(static_cast<unsigned char>(c->get_type()));
+            flags.push_back(
+                (c->get_lower_inclusive() ?
+                    CompiledFuzzySet::lower_inclusive : 0) |
+                (c->get_upper_inclusive() ?
+                    CompiledFuzzySet::upper_inclusive : 0)
+            );
+        }
+        breakpoints.insert(breakpoints.end(),
+            index.get_breakpoints().begin(), index.get_breakpoints().end());
+        for (std::size_t p = 0; p < index.piece_count(); p++)
+            owners.push_back(index.owner(p));
+    }
+
+    FzbHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, fzb_magic, sizeof(fzb_magic));
+    header.version = fzb_version;
+    header.set_count = records.size();
+    header.segment_count = lower.size();
+    header.breakpoint_count = breakpoints.size();
+    header.owner_count = owners.size();
+    header.name_bytes = names.size();
+    // Sections one after another, each starting at a multiple of 8
+    std::uint64_t end = sizeof(FzbHeader);
+    auto place = [&end](std::uint64_t bytes)
+    {
+        std::uint64_t start = end;
+        end = (end + bytes + 7) / 8 * 8;
+        return start;
+    };
+    header.sets = place(records.size() * sizeof(FzbSet));
+    header.lower = place(lower.size() * sizeof(double));
+    header.upper = place(upper.size() * sizeof(double));
+    header.coefficients = place(coefficients.size() * sizeof(double));
+    header.breakpoints = place(breakpoints.size() * sizeof(double));
+    header.owners = place(owners.size() * sizeof(std::int32_t));
+    header.types = place(types.size());
+    header.flags = place(flags.size());
+    header.names = place(names.size());
+    header.file_size = end;
+
+    std::ofstream output_file(filename, std::ios::binary | std::ios::trunc);
+    if (!output_file.good())
+        throw std::invalid_argument("File " + filename + " can't be oppened!");
+    std::uint64_t written = 0;
+    auto write = [&](std::uint64_t offset, const void *data, std::size_t size)
+    {
+        const char zeros[8] = {0};
+        output_file.write(zeros, offset - written);
+        output_file.write(static_cast<const char*>(data), size);
+        written = offset + size;
+    };
+    write(0, &header, sizeof(header));
+    write(header.sets, records.data(), records.size() * sizeof(FzbSet));
+    write(header.lower, lower.data(), lower.size() * sizeof(double));
+    write(header.upper, upper.data(), upper.size() * sizeof(double));
+    write(header.coefficients, coefficients.data(),
+        coefficients.size() * sizeof(double));
+    write(header.breakpoints, breakpoints.data(),
+        breakpoints.size() * sizeof(double));
+    write(header.owners, owners.data(), owners.size() * sizeof(std::int32_t));
+    write(header.types, types.data(), types.size());
+    write(header.flags, flags.data(), flags.size());
+    write(header.names, names.data(), names.size());
+    write(header.file_size, NULL, 0);
+    if (!output_file.good())
+        throw std::runtime_error("Writing file " + filename + " failed!");
+}
+
+BinaryModel::BinaryModel(const std::string &filename):
+_file(filename, MappedFile::Mode::Read)
+{
+    const std::string message = "File " + filename + " is not a valid "
+        "version " + std::to_string(fzb_version) + " .fzb model!";
+    const std::uint64_t size = _file.size();
+    if (size < sizeof(FzbHeader) || !little_endian())
+        throw std::invalid_argument(message);
+    const char *data = _file.map(0, size);
+    _header = reinterpret_cast<const FzbHeader*>(data);
+    const FzbHeader &h = *_header;
+    if (std::memcmp(h.magic, fzb_magic, sizeof(fzb_magic)) != 0
+        || h.version != fzb_version || h.file_size != size)
+        throw std::invalid_argument(message);
+
+    // Every section must lie inside the file, counted in elements of 'unit'
+    auto section = [&](std::uint64_t offset, std::uint64_t count,
+        std::uint64_t unit) -> const char*
+    {
+        if (offset % 8 || offset > size || count > (size - offset) / unit)
+            throw std::invalid_argument(message);
+        return data + offset;
+    };
+    _sets = reinterpret_cast<const FzbSet*>(
+        section(h.sets, h.set_count, sizeof(FzbSet)));
+    _lower = reinterpret_cast<const double*>(
+        section(h.lower, h.segment_count, sizeof(double)));
+    _upper = reinterpret_cast<const double*>(
+        section(h.upper, h.segment_count, sizeof(double)));
+    _coefficients = reinterpret_cast<const double*>(section(
+        h.coefficients, h.segment_count, k_count * sizeof(double)));
+    _breakpoints = reinterpret_cast<const double*>(
+        section(h.breakpoints, h.breakpoint_count, sizeof(double)));
+    _owners = reinterpret_cast<const std::int32_t*>(
+        section(h.owners, h.owner_count, sizeof(std::int32_t)));
+    _types = reinterpret_cast<const unsigned char*>(
+        section(h.types, h.segment_count, 1));
+    _flags = reinterpret_cast<const unsigned char*>(
+        section(h.flags, h.segment_count, 1));
+    _names = section(h.names, h.name_bytes, 1);
+    if (!_valid()) throw std::invalid_argument(message);
+}
+
+bool BinaryModel::_valid(void) const
+{
+    // Ranges of every set inside the sections, owners inside the set
+    const FzbHeader &h = *_header;
+    for (std::size_t s = 0; s < h.set_count; s++)
+    {
+        const FzbSet &set = _sets[s];
+        if (set.name_offset > h.name_bytes
+            || set.name_length > h.name_bytes - set.name_offset
+            || set.first_segment > h.segment_count
+            || set.segment_count > h.segment_count - set.first_segment
+            || set.first_breakpoint > h.breakpoint_count
+            || set.breakpoint_count > h.breakpoint_count - set.first_breakpoint
+            || set.first_owner > h.owner_count
+            || 2 * set.breakpoint_count + 1 > h.owner_count - set.first_owner)
+            return false;
+        const std::int32_t *owners = _owners + set.first_owner;
+        for (std::size_t p = 0; p < 2 * set.breakpoint_count + 1; p++)
+            if (owners[p] < -1
+                || owners[p] >= std::int64_t(set.segment_count))
+                return false;
+    }
+    const std::size_t types = defined_curves().size();
+    for (std::size_t i = 0; i < h.segment_count; i++)
+        if (_types[i] >= types) return false;
+    return true;
+}
+
+std::size_t BinaryModel::size(void) const {return _header->set_count;}
+
+std::string BinaryModel::get_name(std::size_t set) const
+{
+    return std::string(
+        _names + _sets[set].name_offset, _sets[set].name_length
+    );
+}
+
+std::size_t BinaryModel::find(const std::string &name) const
+{
+    for (std::size_t s = 0; s < size(); s++)
+        if (get_name(s) == name) return s;
+    throw std::out_of_range("Model has no set '" + name + "'!");
+}
+
+double BinaryModel::membership(std::size_t set, double value) const
+{
+    if (value != value) return 0;  // NaN is contained in no curve
+    const FzbSet &s = _sets[set];
+    const double *breakpoints = _breakpoints + s.first_breakpoint;
+    const std::size_t i = std::upper_bound(
+        breakpoints, breakpoints + s.breakpoint_count, value
+    ) - breakpoints;
+    std::size_t piece = 2 * i;
+    if (i > 0 && breakpoints[i - 1] == value) piece--;
+    const std::int32_t owner = _owners[s.first_owner + piece];
+    if (owner < 0) return 0;
+    const std::size_t segment = s.first_segment + owner;
+    return CompiledFuzzySet::evaluate(
+        static_cast<CurveType>(_types[segment]),
+        _coefficients + segment * k_count, value
+    );
+}
+
+void BinaryModel::membership(
+    std::size_t set, const double *input, double *output, std::size_t count
+) const
+{
+    for (std::size_t i = 0; i < count; i++)
+        output[i] = membership(set, input[i]);
+}
+
+std::vector<FuzzySet> BinaryModel::get_sets(void) const
+{
+    // Every segment of the file in one arena shared by the sets
+    std::vector<CurveParameters> curve_types = defined_curves();
+    std::vector<CurveVariant> curves;
+    curves.reserve(_header->segment_count);
+    for (std::size_t segment = 0; segment < _header->segment_count; segment++)
+    {
+        const double *k = _coefficients + segment * k_count;
+        const CurveParameters &type = curve_types[_types[segment]];
+        const std::size_t n = type.parameters.size() + type.optional.size();
+        curves.push_back(make_curve_variant(
+            static_cast<CurveType>(_types[segment]),
+            std::vector<double>(k, k + n),
+            _lower[segment], _upper[segment],
+            _flags[segment] & CompiledFuzzySet::lower_inclusive,
+            _flags[segment] & CompiledFuzzySet::upper_inclusive
+        ));
+    }
+    std::shared_ptr<const CurveArena> arena =
+        std::make_shared<CurveArena>(std::move(curves));
+    std::vector<FuzzySet> sets;
+    sets.reserve(size());
+    for (std::size_t s = 0; s < size(); s++)
+        sets.emplace_back(
+            get_name(s), arena, _sets[s].first_segment, _sets[s].segment_count
+        );
+    return sets;
+}
+
+std::vector<FuzzySet> load_binary_model(const std::string &filename)
+{
+    FUZZY_INSTRUMENT_ONLY(LatencyTimer timer(Latency::Load));
+    return BinaryModel(filename).get_sets();
+}
+
+bool is_binary_model(const std::string &filename)
+{
+    const std::string extension = ".fzb";
+    return filename.size() >= extension.size() && filename.compare(
+        filename.size() - extension.size(), extension.size(), extension
+    ) == 0;
+}
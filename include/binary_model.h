@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "fuzzy.h"
+#include "mapped_file.h"
+
+/* Layout of the '.fzb' binary model format, all little-endian.
+The file starts with 'FzbHeader', followed by sections at the offsets it
+lists, each aligned to 8 bytes:
+    sets          'FzbSet' record per set
+    lower, upper  double bounds per segment (curve)
+    coefficients  'CompiledFuzzySet::coefficient_count' doubles per segment
+                  in the form given by 'CompiledFuzzySet::get_coefficients'
+    breakpoints   doubles, sorted table of each set's SegmentIndex
+    owners        int32, 2 * breakpoints + 1 per set, segment within the set
+                  owning the piece or -1
+    types, flags  byte per segment, CurveType and inclusivity flags of
+                  CompiledFuzzySet
+    names         UTF-8 set names, not terminated
+Parameters are stored as they are, so a model converted to '.fzb' and back
+gives the same JSON. 'fzb_version' changes with any change of the layout. */
+const char fzb_magic[4] = {'F', 'Z', 'B', '\0'};
+const std::uint32_t fzb_version = 1;
+
+typedef struct fzb_header
+{
+    char magic[4];
+    std::uint32_t version;
+    std::uint64_t file_size;
+    std::uint64_t set_count, segment_count, breakpoint_count, owner_count;
+    std::uint64_t name_bytes;
+    std::uint64_t sets, lower, upper, coefficients, breakpoints, owners;
+    std::uint64_t types, flags, names;
+} FzbHeader;
+
+typedef struct fzb_set
+{
+    std::uint64_t name_offset, name_length;
+    std::uint64_t first_segment, segment_count;
+    std::uint64_t first_breakpoint, breakpoint_count;
+    std::uint64_t first_owner;
+} FzbSet;
+
+class BinaryModel
+{
+    /* Sets of a '.fzb' file evaluated in place - the file is mapped and
+    the sections are used as they are, opening only checks that the header
+    and the tables are consistent. */
+    private:
+        MappedFile _file;
+        const FzbHeader *_header = nullptr;
+        const FzbSet *_sets = nullptr;
+        const double *_lower = nullptr, *_upper = nullptr;
+        const double *_coefficients = nullptr, *_breakpoints = nullptr;
+        const std::int32_t *_owners = nullptr;
+        const unsigned char *_types = nullptr, *_flags = nullptr;
+        const char *_names = nullptr;
+    public:
+        BinaryModel(const std::string &filename);
+        std::size_t size(void) const;
+        std::string get_name(std::size_t set) const;
+        std::size_t find(const std::string &name) const;
+        double membership(std::size_t set, double value) const;
+        void membership(
+            std::size_t set, const double *input, double *output,
+            std::size_t count
+        ) const;
+        // Editable copies of the stored sets
+        std::vector<FuzzySet> get_sets(void) const;
+    private:
+        bool _valid(void) const;
+};
+
+void save_binary_model(
+    const std::vector<FuzzySet> &sets, const std::string &filename
+);
+std::vector<FuzzySet> load_binary_model(const std::string &filename);
+// True for file names ending with '.fzb'
+bool is_binary_model(const std::string &filename);
@@ -0,0 +1,34 @@
+#include "buffered_writer.h"
+#include <cstring>
+#include <stdexcept>
+
+BufferedWriter::BufferedWriter(std::FILE *file, std::size_t size):
+_file(file), _buffer(size) {}
+
+BufferedWriter::~BufferedWriter(void)
+{
+    if (_used) std::fwrite(_buffer.data(), 1, _used, _file);
+}
+
+char *BufferedWriter::reserve(std::size_t size)
+{
+    if (_used + size > _buffer.size()) flush();
+    if (size > _buffer.size()) _buffer.resize(size);
+    return _buffer.data() + _used;
+}
+
+void BufferedWriter::commit(char *end) {_used = end - _buffer.data();}
+
+void BufferedWriter::write(const std::string &text)
+{
+    char *out = reserve(text.size());
+    std::memcpy(out, text.data(), text.size());
+    commit(out + text.size());
+}
+
+void BufferedWriter::flush(void)
+{
+    if (std::fwrite(_buffer.data(), 1, _used, _file) != _used)
+        throw std::runtime_error("Writing output failed!");
+    _used = 0;
+}
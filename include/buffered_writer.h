@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdio>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class BufferedWriter
+{
+    // Collects output in one large buffer written with a single fwrite
+    private:
+        std::FILE *_file;
+        std::vector<char> _buffer;
+        std::size_t _used = 0;
+    public:
+        BufferedWriter(std::FILE *file, std::size_t buffer_size);
+        ~BufferedWriter(void);
+        // Free space of at least 'size' bytes, flushes when needed
+        char *reserve(std::size_t size);
+        void commit(char *end);
+        void write(const std::string &text);
+        void flush(void);
+};
@@ -0,0 +1,415 @@
+#include "cli.h"
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <fstream>
+#include "fuzzy.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+#include "binary_model.h"
+#include "render.h"
+#include "instrument.h"
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+const std::size_t io_buffer_size = 1 << 20;
+// Values evaluated per batch call, results of all sets stay in L2 cache
+const std::size_t block_size = 4096;
+
+// Default values per mapped window in 'batch', 8 MiB of input
+const std::size_t chunk_size = 1 << 20;
+// Values per task of the thread pool in 'batch'
+const std::size_t parallel_chunk = 16384;
+
+const char *usage =
+    "Usage: fuzzy eval --model <sets.json> [--model <more.json>...]\n"
+    "                  [--input <values>] [--output <out.csv>] [--binary]\n"
+    "       fuzzy batch --model <sets.json> [--model <more.json>...]\n"
+    "                   --input <values.bin> --output <memberships.bin>\n"
+    "                   [--chunk <values>] [--threads <count>]\n"
+    "       fuzzy convert <model.json|model.fzb> <model.fzb|model.json>\n"
+    "       fuzzy plot --model <sets.json> [--model <more.json>...]\n"
+    "                  --output <plot.svg|plot.png>\n"
+    "                  [--width <pixels>] [--height <pixels>]\n"
+    "       eval, batch and plot take [--report <report.json>] too\n";
+
+ValueReader::ValueReader(std::FILE *file, bool binary, std::size_t size):
+_file(file), _binary(binary), _buffer(size) {}
+
+void ValueReader::_refill(void)
+{
+    // Keep the unconsumed tail, append as much as fits after it
+    std::memmove(_buffer.data(), _buffer.data() + _begin, _end - _begin);
+    _end -= _begin;
+    _begin = 0;
+    std::size_t wanted = _buffer.size() - _end;
+    std::size_t got = std::fread(_buffer.data() + _end, 1, wanted, _file);
+    _end += got;
+    if (got < wanted)
+    {
+        if (std::ferror(_file))
+            throw std::runtime_error("Reading input failed!");
+        _eof = true;
+    }
+}
+
+std::size_t ValueReader::read(double *values, std::size_t count)
+{
+    return _binary ? _read_binary(values, count) : _read_text(values, count);
+}
+
+std::size_t ValueReader::_read_binary(double *values, std::size_t count)
+{
+    if (_end - _begin < sizeof(double) && !_eof) _refill();
+    std::size_t available = (_end - _begin) / sizeof(double);
+    if (available == 0)
+    {
+        if (_end != _begin)
+            throw std::invalid_argument("Input ends with a partial value!");
+        return 0;
+    }
+    std::size_t n = std::min(count, available);
+    std::memcpy(values, _buffer.data() + _begin, n * sizeof(double));
+    _begin += n * sizeof(double);
+    return n;
+}
+
+inline bool is_space(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+std::size_t ValueReader::_read_text(double *values, std::size_t count)
+{
+    std::size_t n = 0;
+    while (n < count)
+    {
+        const char *data = _buffer.data();
+        while (_begin < _end && is_space(data[_begin]))
+            if (data[_begin++] == '\n') _line++;
+        if (_begin == _end)
+        {
+            if (_eof) break;
+            _refill();
+            continue;
+        }
+
+        std::size_t token_end = _begin;
+        while (token_end < _end && !is_space(data[token_end])) token_end++;
+        if (token_end == _end && !_eof)
+        {
+            // Number may continue in the next chunk
+            if (_end - _begin == _buffer.size())
+                throw std::invalid_argument(
+                    "Token too long on line " + std::to_string(_line) + "!"
+                );
+            _refill();
+            continue;
+        }
+
+        const char *first = data + _begin, *last = data + token_end;
+        std::from_chars_result result =
+            std::from_chars(first, last, values[n]);
+        if (result.ec != std::errc() || result.ptr != last)
+        {
+            std::string message = "Invalid number '"
+                + std::string(first, last) + "' on line "
+                + std::to_string(_line) + "!";
+            throw std::invalid_argument(message);
+        }
+        n++;
+        _begin = token_end;
+    }
+    return n;
+}
+
+std::FILE *open_stream(const std::string &path, bool output)
+{
+    if (path.empty() || path == "-")
+    {
+        std::FILE *stream = output ? stdout : stdin;
+#ifdef _WIN32
+        _setmode(_fileno(stream), _O_BINARY);
+#endif
+        return stream;
+    }
+    std::FILE *file = std::fopen(path.c_str(), output ? "wb" : "rb");
+    if (!file)
+        throw std::invalid_argument("File " + path + " can't be oppened!");
+    return file;
+}
+
+void evaluate_stream(
+    const ModelSets &sets, ValueReader &reader, BufferedWriter &writer
+)
+{
+    std::string header = "value";
+    for (std::size_t s = 0; s < sets.size(); s++)
+        header += ";" + sets.get_name(s);
+    writer.write(header + "\n");
+
+    // Shortest representation that reads back to the same double
+    const std::size_t number_size = 32;
+    const std::size_t row_size = (sets.size() + 1) * (number_size + 1);
+    std::vector<double> values(block_size);
+    std::vector<double> memberships(block_size * sets.size());
+    while (std::size_t n = reader.read(values.data(), block_size))
+    {
+        for (std::size_t s = 0; s < sets.size(); s++)
+            sets.membership(
+                s, values.data(), memberships.data() + s * block_size, n
+            );
+        for (std::size_t i = 0; i < n; i++)
+        {
+            char *out = writer.reserve(row_size);
+            out = std::to_chars(out, out + number_size, values[i]).ptr;
+            for (std::size_t s = 0; s < sets.size(); s++)
+            {
+                *out++ = ';';
+                out = std::to_chars(
+                    out, out + number_size, memberships[s * block_size + i]
+                ).ptr;
+            }
+            *out++ = '\n';
+            writer.commit(out);
+        }
+    }
+    writer.flush();
+}
+
+ModelSets::ModelSets(const std::vector<std::string> &models)
+{
+    if (models.empty())
+        throw std::invalid_argument(std::string("No model given!\n") + usage);
+    for (const std::string &model: models)
+    {
+        if (is_binary_model(model))
+        {
+            _models.push_back(std::make_unique<BinaryModel>(model));
+            for (std::size_t s = 0; s < _models.back()->size(); s++)
+                _columns.push_back({int(_models.size() - 1), s});
+            continue;
+        }
+        for (FuzzySet &set: load_fuzzy_sets(model))
+        {
+            _columns.push_back({-1, _sets.size()});
+            _sets.push_back(std::move(set));
+        }
+    }
+}
+
+std::size_t ModelSets::size(void) const {return _columns.size();}
+
+std::string ModelSets::get_name(std::size_t set) const
+{
+    const Column &c = _columns[set];
+    if (c.model < 0) return _sets[c.set].get_name();
+    return _models[c.model]->get_name(c.set);
+}
+
+void ModelSets::membership(
+    std::size_t set, const double *input, double *output, std::size_t count
+) const
+{
+    const Column &c = _columns[set];
+    if (c.model < 0) _sets[c.set].membership(input, output, count);
+    else _models[c.model]->membership(c.set, input, output, count);
+}
+
+const std::vector<FuzzySet> &ModelSets::get_sets(void) const {return _sets;}
+
+// Models are JSON files, or binary ones when named '*.fzb'
+std::vector<FuzzySet> load_models(const std::vector<std::string> &models)
+{
+    if (models.empty())
+        throw std::invalid_argument(std::string("No model given!\n") + usage);
+    std::vector<FuzzySet> sets;
+    for (std::string model: models)
+        for (FuzzySet &set: is_binary_model(model) ?
+            load_binary_model(model) : load_fuzzy_sets(model))
+            sets.push_back(set);
+    return sets;
+}
+
+void run_eval(int argc, char **argv)
+{
+    std::vector<std::string> models;
+    std::string input, output, report;
+    bool binary = false;
+    for (int i = 2; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        bool has_value = i + 1 < argc;
+        if (argument == "--binary") binary = true;
+        else if (argument == "--model" && has_value)
+            models.push_back(argv[++i]);
+        else if (argument == "--input" && has_value) input = argv[++i];
+        else if (argument == "--output" && has_value) output = argv[++i];
+        else if (argument == "--report" && has_value) report = argv[++i];
+        else
+            throw std::invalid_argument("Unexpected argument '" + argument
+                + "'!\n" + usage);
+    }
+    ModelSets sets(models);
+
+    std::FILE *in = open_stream(input, false);
+    std::FILE *out = open_stream(output, true);
+    try
+    {
+        ValueReader reader(in, binary, io_buffer_size);
+        BufferedWriter writer(out, io_buffer_size);
+        evaluate_stream(sets, reader, writer);
+    }
+    catch (...)
+    {
+        if (in != stdin) std::fclose(in);
+        if (out != stdout) std::fclose(out);
+        throw;
+    }
+    if (in != stdin) std::fclose(in);
+    if (out != stdout && std::fclose(out) != 0)
+        throw std::runtime_error("Writing output failed!");
+    if (!report.empty()) save_instrumentation_report(sets.get_sets(), report);
+}
+
+void run_batch(int argc, char **argv)
+{
+    std::vector<std::string> models;
+    std::string input, output, report;
+    std::size_t chunk = chunk_size;
+    unsigned threads = 0;
+    for (int i = 2; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        bool has_value = i + 1 < argc;
+        if (argument == "--model" && has_value) models.push_back(argv[++i]);
+        else if (argument == "--input" && has_value) input = argv[++i];
+        else if (argument == "--output" && has_value) output = argv[++i];
+        else if (argument == "--chunk" && has_value)
+            chunk = std::stoull(argv[++i]);
+        else if (argument == "--threads" && has_value)
+            threads = std::stoul(argv[++i]);
+        else if (argument == "--report" && has_value) report = argv[++i];
+        else
+            throw std::invalid_argument("Unexpected argument '" + argument
+                + "'!\n" + usage);
+    }
+    if (input.empty() || output.empty() || chunk == 0)
+        throw std::invalid_argument(
+            std::string("Input, output and chunk size are required!\n") + usage
+        );
+    ModelSets sets(models);
+    ThreadPool pool(threads);
+
+    /* Input holds raw doubles, output one column of doubles per set:
+    memberships of all values in the first set, then in the second... Sets
+    are evaluated straight from the mapped input into the mapped output. */
+    MappedFile in(input, MappedFile::Mode::Read);
+    if (in.size() % sizeof(double))
+        throw std::invalid_argument("Input ends with a partial value!");
+    const std::uint64_t count = in.size() / sizeof(double);
+    MappedFile out(output, MappedFile::Mode::Write,
+        count * sets.size() * sizeof(double));
+    for (std::uint64_t start = 0; start < count; start += chunk)
+    {
+        const std::size_t n = std::min<std::uint64_t>(chunk, count - start);
+        const double *values = reinterpret_cast<const double*>(
+            in.map(start * sizeof(double), n * sizeof(double))
+        );
+        for (std::size_t s = 0; s < sets.size(); s++)
+        {
+            std::uint64_t offset = (s * count + start) * sizeof(double);
+            double *memberships = reinterpret_cast<double*>(
+                out.map(offset, n * sizeof(double))
+            );
+            pool.parallel_for(n, parallel_chunk,
+                [&](std::size_t begin, std::size_t end)
+                {
+                    sets.membership(
+                        s, values + begin, memberships + begin, end - begin
+                    );
+                });
+        }
+    }
+    if (!report.empty()) save_instrumentation_report(sets.get_sets(), report);
+}
+
+// Between JSON and '.fzb', the direction is given by the file names
+void run_convert(int argc, char **argv)
+{
+    if (argc != 4)
+        throw std::invalid_argument(std::string("Wrong arguments!\n") + usage);
+    std::string input = argv[2], output = argv[3];
+    if (is_binary_model(input) == is_binary_model(output))
+        throw std::invalid_argument(
+            "Exactly one of the files must be a '.fzb' model!"
+        );
+    std::vector<FuzzySet> sets = load_models({input});
+    if (is_binary_model(output))
+    {
+        save_binary_model(sets, output);
+        return;
+    }
+    std::ofstream output_file(output, std::ios::trunc);
+    if (!output_file.good())
+        throw std::invalid_argument("File " + output + " can't be oppened!");
+    json j = json::array();
+    for (FuzzySet &set: sets) j.push_back(set.get_json());
+    output_file << j.dump(4) << std::endl;
+}
+
+void run_plot(int argc, char **argv)
+{
+    std::vector<std::string> models;
+    std::string output, report;
+    int width = 800, height = 500;
+    for (int i = 2; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        bool has_value = i + 1 < argc;
+        if (argument == "--model" && has_value) models.push_back(argv[++i]);
+        else if (argument == "--output" && has_value) output = argv[++i];
+        else if (argument == "--width" && has_value)
+            width = std::stoi(argv[++i]);
+        else if (argument == "--height" && has_value)
+            height = std::stoi(argv[++i]);
+        else if (argument == "--report" && has_value) report = argv[++i];
+        else
+            throw std::invalid_argument("Unexpected argument '" + argument
+                + "'!\n" + usage);
+    }
+    if (output.empty())
+        throw std::invalid_argument(
+            std::string("Output file is required!\n") + usage
+        );
+    std::vector<FuzzySet> sets = load_models(models);
+    render_plot(sets, output, width, height);
+    if (!report.empty()) save_instrumentation_report(sets, report);
+}
+
+int run_command(int argc, char **argv)
+{
+    try
+    {
+        std::string command = argc > 1 ? argv[1] : "";
+        if (command == "eval") run_eval(argc, argv);
+        else if (command == "batch") run_batch(argc, argv);
+        else if (command == "convert") run_convert(argc, argv);
+        else if (command == "plot") run_plot(argc, argv);
+        else
+        {
+            std::cerr << "Unknown command '" << command << "'!\n" << usage;
+            return 1;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdio>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "buffered_writer.h"
+#include "fuzzy.h"
+#include "binary_model.h"
+
+/* Headless front end, used when the program gets command line arguments:
+
+    fuzzy eval --model <sets.json> [--model <more.json>...]
+               [--input <values>] [--output <out.csv>] [--binary]
+
+Reads values (text numbers separated by whitespace, or raw native doubles
+with '--binary') from the input file or stdin and writes one CSV row
+'value;membership...' per value, with a header naming the sets, to the
+output file or stdout. Input and output are streamed in fixed size chunks,
+so memory use does not depend on the input size.
+
+    fuzzy batch --model <sets.json> [--model <more.json>...]
+                --input <values.bin> --output <memberships.bin>
+                [--chunk <values>] [--threads <count>]
+
+Memory maps a file of raw native (little-endian) doubles and writes a file
+of doubles with one column per set, column 's' starting at value
+'s * count'. Both files are mapped one chunk at a time (default 2^20
+values), each chunk is evaluated by a thread pool (default one thread per
+core).
+
+    fuzzy convert <model.json|model.fzb> <model.fzb|model.json>
+
+Converts a model between JSON and the binary '.fzb' format, which all
+commands accept as '--model' too. Eval and batch evaluate '.fzb' models in
+place from the mapped file.
+
+    fuzzy plot --model <sets.json> [--model <more.json>...]
+               --output <plot.svg|plot.png>
+               [--width <pixels>] [--height <pixels>]
+
+Draws all sets into an SVG, or a PNG for names ending with '.png', see
+'render_plot' (default 800x500 pixels).
+
+With '--report <report.json>' eval, batch and plot finally save the
+counters and latency histograms of 'instrumentation_report', which only
+holds '{"enabled": false}' unless built with FUZZY_INSTRUMENT. Sets of
+'.fzb' models evaluated in place are not counted.
+
+All commands return the process exit code, errors are reported on
+stderr. */
+int run_command(int argc, char **argv);
+
+class ValueReader
+{
+    /* Pulls doubles out of a file in large chunks. Text numbers are parsed
+    in place with std::from_chars, a number cut by the chunk end is moved to
+    the front and completed by the next read. */
+    private:
+        std::FILE *_file;
+        bool _binary;
+        std::vector<char> _buffer;
+        std::size_t _begin = 0, _end = 0;
+        bool _eof = false;
+        std::size_t _line = 1;
+    public:
+        ValueReader(std::FILE *file, bool binary, std::size_t buffer_size);
+        // Fills up to 'count' values, returns how many, 0 at the end
+        std::size_t read(double *values, std::size_t count);
+    private:
+        void _refill(void);
+        std::size_t _read_binary(double *values, std::size_t count);
+        std::size_t _read_text(double *values, std::size_t count);
+};
+
+class ModelSets
+{
+    /* Sets of the '--model' files in the order given. JSON models are
+    loaded as FuzzySets, '.fzb' models stay mapped and their sets are
+    evaluated in place by BinaryModel, without building any curve. */
+    private:
+        typedef struct column
+        {
+            int model;          // index into '_models', -1 for '_sets'
+            std::size_t set;
+        } Column;
+        std::vector<FuzzySet> _sets;
+        std::vector<std::unique_ptr<BinaryModel>> _models;
+        std::vector<Column> _columns;
+    public:
+        ModelSets(const std::vector<std::string> &models);
+        std::size_t size(void) const;
+        std::string get_name(std::size_t set) const;
+        void membership(
+            std::size_t set, const double *input, double *output,
+            std::size_t count
+        ) const;
+        // Sets loaded from JSON, the ones instrumentation counts
+        const std::vector<FuzzySet> &get_sets(void) const;
+};
@@ -0,0 +1,179 @@
+#include "codegen.h"
+#include <sstream>
+#include <cmath>
+#include <math.h>
+#include <cstdio>
+#include <cctype>
+#include <map>
+#include <stdexcept>
+
+std::string literal(double value)
+{
+    if (std::isinf(value)) return value > 0 ? "INFINITY" : "-INFINITY";
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.17g", value);
+    std::string result = buffer;
+    if (result.find_first_of(".e") == std::string::npos) result += ".0";
+    return result;
+}
+
+/* Literal added to an expression. Zero is kept, adding it turns -0 into +0
+as the curve classes do, and a negative zero is subtracted as +0. */
+std::string plus(double value)
+{
+    if (std::signbit(value)) return " - " + literal(-value);
+    return " + " + literal(value);
+}
+
+// 'value * x' added to an expression, subtracting gives the same result
+std::string plus_times(double value, const std::string &x)
+{
+    if (std::signbit(value)) return " - " + literal(-value) + " * " + x;
+    return " + " + literal(value) + " * " + x;
+}
+
+std::string identifier(std::string name)
+{
+    std::string result;
+    for (char c: name)
+        result += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+    if (result.empty() || std::isdigit(static_cast<unsigned char>(result[0])))
+        result = "_" + result;
+    return result;
+}
+
+/* Same operations in the same order as 'membership' of the curve classes,
+so the generated functions give the same doubles as FuzzySet. Only ln(base)
+of logarithms is computed here instead of on every call, and a zero linear
+term of a bounded quadratic is left out where it can't change the result.
+The fast form uses Horner's scheme with std::fma and replaces the division
+and std::pow by a multiplication with 1 / ln(base) and ln(base). */
+std::string expression(const Curve *curve, bool fast)
+{
+    std::vector<double> p = curve->get_parameters();
+    switch (curve->get_type())
+    {
+        case CurveType::Constant:
+            return literal(p[0]);
+        case CurveType::Linear:
+            if (fast)
+                return "std::fma(" + literal(p[0]) + ", x, "
+                    + literal(p[1]) + ")";
+            return literal(p[0]) + " * x" + plus(p[1]);
+        case CurveType::Quadratic:
+            if (fast)
+                return "std::fma(std::fma(" + literal(p[0]) + ", x, "
+                    + literal(p[1]) + "), x, " + literal(p[2]) + ")";
+            // 0 * x is +-0 for finite x, adding it and then 'c' changes
+            // nothing unless 'c' is -0
+            if (p[1] == 0 && curve->is_finite() && !std::signbit(p[2]))
+                return literal(p[0]) + " * x * x" + plus(p[2]);
+            return literal(p[0]) + " * x * x" + plus_times(p[1], "x")
+                + plus(p[2]);
+        case CurveType::Exponential:
+            if (fast && p[3] == 1)
+                return "std::exp(" + literal(log(p[0])) + " * (x"
+                    + plus(-p[1]) + "))" + plus(p[2]);
+            if (fast)
+                return "std::fma(" + literal(p[3]) + ", std::exp("
+                    + literal(log(p[0])) + " * (x" + plus(-p[1]) + ")), "
+                    + literal(p[2]) + ")";
+            return (p[3] != 1 ? literal(p[3]) + " * " : "")
+                + "std::pow(" + literal(p[0]) + ", x" + plus(-p[1]) + ")"
+                + plus(p[2]);
+        case CurveType::Logarithmic:
+            if (fast)
+                return "std::fma(std::log(x" + plus(-p[1]) + "), "
+                    + literal(1 / log(p[0])) + ", " + literal(p[2]) + ")";
+            return "std::log(x" + plus(-p[1]) + ") / "
+                + literal(log(p[0])) + plus(p[2]);
+    }
+    return "0.0";
+}
+
+/* Pieces of the segment index with equal results are merged into one
+comparison. The open pieces below -inf and above +inf hold no value and
+join their neighbour. NaN gives 0 and shares the first comparison when that
+returns 0 as well. */
+void generate_function(
+    std::ostringstream &output, const FuzzySet &set, bool fast
+)
+{
+    const SegmentIndex &index = set.get_index();
+    const std::vector<double> &breakpoints = index.get_breakpoints();
+    const std::vector<const Curve*> &curves = set.get_curves();
+    const std::size_t count = index.piece_count();
+
+    std::vector<std::string> results(count);
+    for (std::size_t p = 0; p < count; p++)
+    {
+        int owner = index.owner(p);
+        results[p] = owner < 0 ? "0.0" : expression(curves[owner], fast);
+    }
+    std::size_t first = 0, last = count - 1;
+    if (!breakpoints.empty() && breakpoints.front() == -INFINITY) first = 1;
+    if (!breakpoints.empty() && breakpoints.back() == INFINITY)
+        results[last] = results[last - 1];
+
+    output << "inline double membership_" << identifier(set.get_name())
+        << "(double x)\n{\n";
+    bool nan_handled = false;
+    for (std::size_t p = first; p <= last; p++)
+    {
+        // Extend the run while the next piece gives the same result
+        if (p < last && results[p + 1] == results[p]) continue;
+        if (p == last)
+        {
+            if (!nan_handled && results[p] != "0.0")
+                output << "    if (x != x) return 0.0;\n";
+            output << "    return " << results[p] << ";\n";
+            break;
+        }
+        // Even pieces are open intervals ending before breakpoint p / 2,
+        // odd pieces are the breakpoint itself
+        const bool inclusive = p % 2;
+        const std::string bound = literal(breakpoints[p / 2]);
+        if (!nan_handled && results[p] == "0.0")
+            output << "    if (!(x " << (inclusive ? ">" : ">=") << " "
+                << bound << ")) return 0.0;\n";
+        else
+        {
+            if (!nan_handled) output << "    if (x != x) return 0.0;\n";
+            output << "    if (x " << (inclusive ? "<=" : "<") << " "
+                << bound << ") return " << results[p] << ";\n";
+        }
+        nan_handled = true;
+    }
+    output << "}\n";
+}
+
+std::string generate_header(
+    const std::vector<FuzzySet> &sets, std::string source,
+    std::string name_space, bool fast
+)
+{
+    // Function names must stay unique after the mapping to identifiers
+    std::map<std::string, std::string> names;
+    for (const FuzzySet &set: sets)
+    {
+        const std::string name = identifier(set.get_name());
+        auto inserted = names.emplace(name, set.get_name());
+        if (!inserted.second)
+            throw std::invalid_argument("Sets '" + inserted.first->second
+                + "' and '" + set.get_name() + "' would both generate "
+                "'membership_" + name + "'!");
+    }
+
+    std::ostringstream output;
+    output << "// Generated by codegen";
+    if (!source.empty()) output << " from '" << source << "'";
+    output << ", do not edit.\n#pragma once\n\n#include <cmath>\n\n";
+    if (!name_space.empty()) output << "namespace " << name_space << "\n{\n\n";
+    for (const FuzzySet &set: sets)
+    {
+        generate_function(output, set, fast);
+        output << "\n";
+    }
+    if (!name_space.empty()) output << "}\n";
+    return output.str();
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "fuzzy.h"
+
+/* Emits a self-contained C++ header with one 'inline double
+membership_<name>(double x)' function per set. Adjacent pieces of the
+segment index with the same result are merged, so each function is a short
+sorted chain of comparisons against constant bounds followed by the curve
+expression. By default the expression is written as 'membership' of the
+curve class computes it, so the results equal FuzzySet::membership bit for
+bit, signed zeros included, on the machine that generated the header. With
+'fast' polynomials use Horner's scheme with std::fma and logarithms and
+exponentials a precomputed 1 / ln(base) and ln(base), the results then
+differ from FuzzySet by rounding, within 1e-12 for finite x and memberships
+in [0, 1].
+Throws std::invalid_argument when two set names map to the same
+identifier. */
+std::string generate_header(
+    const std::vector<FuzzySet> &sets, std::string source = "",
+    std::string name_space = "", bool fast = false
+);
+
+std::string identifier(std::string name);
@@ -0,0 +1,86 @@
+#include "compiled.h"
+#include <cmath>
+#include <math.h>
+
+CompiledFuzzySet::CompiledFuzzySet(const FuzzySet &set)
+{
+    _name = set.get_name();
+    const std::vector<const Curve*> &curves = set.get_curves();
+    _types.reserve(curves.size());
+    _coefficients.reserve(curves.size() * coefficient_count);
+    for (const Curve *c: curves) _compile_curve(c);
+    _index = set.get_index();
+}
+
+void CompiledFuzzySet::_compile_curve(const Curve *curve)
+{
+    _types.push_back(curve->get_type());
+
+    double coefficients[coefficient_count];
+    get_coefficients(curve, coefficients);
+    _coefficients.insert(
+        _coefficients.end(), coefficients, coefficients + coefficient_count
+    );
+}
+
+void CompiledFuzzySet::get_coefficients(
+    const Curve *curve, double *coefficients
+)
+{
+    std::vector<double> parameters = curve->get_parameters();
+    for (std::size_t i = 0; i < coefficient_count; i++)
+        coefficients[i] = i < parameters.size() ? parameters[i] : 0;
+    // Logarithm of the base is the same for every evaluation
+    if (curve->get_type() == CurveType::Logarithmic)
+        coefficients[coefficient_count - 1] = log(parameters[0]);
+}
+
+double CompiledFuzzySet::segment_membership(
+    std::size_t segment, double value
+) const
+{
+    return evaluate(
+        _types[segment], &_coefficients[segment * coefficient_count], value
+    );
+}
+
+double CompiledFuzzySet::evaluate(
+    CurveType type, const double *k, double value
+)
+{
+    // Same expressions as the 'membership' methods of the Curve classes
+    switch (type)
+    {
+        case CurveType::Constant:
+            return k[0];
+        case CurveType::Linear:
+            return k[0] * value + k[1];
+        case CurveType::Quadratic:
+            return k[0]*value*value + k[1]*value + k[2];
+        case CurveType::Exponential:
+            return k[3] * pow(k[0], (value - k[1])) + k[2];
+        case CurveType::Logarithmic:
+            return log(value - k[1]) / k[3] + k[2];
+    }
+    return 0;
+}
+
+double CompiledFuzzySet::membership(double value) const
+{
+    int i = _index.find(value);
+    if (i < 0) return 0;
+    return segment_membership(i, value);
+}
+
+void CompiledFuzzySet::membership(
+    const double *input, double *output, std::size_t count
+) const
+{
+    for (std::size_t i = 0; i < count; i++) output[i] = membership(input[i]);
+}
+
+std::size_t CompiledFuzzySet::size(void) const {return _types.size();}
+
+const SegmentIndex &CompiledFuzzySet::get_index(void) const {return _index;}
+
+std::string CompiledFuzzySet::get_name(void) const {return _name;}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+#include "curves.h"
+#include "fuzzy.h"
+#include "segment_index.h"
+
+class CompiledFuzzySet
+{
+    /* Read-only, flattened copy of a FuzzySet meant for evaluation.
+    Segments are stored as structure of arrays - curve tags and coefficients
+    each live in one contiguous vector, so no pointers are chased and no
+    virtual calls are made. Bounds are only needed to find the segment of a
+    value, which the copied SegmentIndex already does. The FuzzySet it was
+    built from stays the editable form, recompile after changing it. */
+    public:
+        static const std::size_t coefficient_count = 4;
+        // Bits of the segment flags of a binary model
+        static const unsigned char lower_inclusive = 1;
+        static const unsigned char upper_inclusive = 2;
+    private:
+        std::string _name = "";
+        std::vector<CurveType> _types;
+        // 'coefficient_count' values per segment, see 'get_coefficients'
+        std::vector<double> _coefficients;
+        SegmentIndex _index;
+    public:
+        CompiledFuzzySet(void) {};
+        CompiledFuzzySet(const FuzzySet &set);
+        double membership(double value) const;
+        void membership(
+            const double *input, double *output, std::size_t count
+        ) const;
+        double segment_membership(std::size_t segment, double value) const;
+        std::size_t size(void) const;
+        const SegmentIndex &get_index(void) const;
+        std::string get_name(void) const;
+        /* Evaluation form of a curve - its parameters in the order of
+        'get_parameters', zero padded, except that logarithmic curves keep
+        the logarithm of their base in the last (unused) slot. */
+        static void get_coefficients(const Curve *curve, double *coefficients);
+        static double evaluate(
+            CurveType type, const double *coefficients, double value
+        );
+    private:
+        void _compile_curve(const Curve *curve);
+};
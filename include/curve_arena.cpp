@@ -0,0 +1,34 @@
+#include "curve_arena.h"
+#include "instrument.h"
+#include <utility>
+
+CurveArena::CurveArena(std::vector<CurveVariant> curves)
+{
+    _curves = std::move(curves);
+    _point();
+}
+
+CurveArena::CurveArena(const std::vector<Curve*> &curves)
+{
+    _curves.reserve(curves.size());
+    for (const Curve *c: curves) _curves.push_back(to_variant(c));
+    _point();
+}
+
+CurveArena::~CurveArena(void)
+{
+    FUZZY_INSTRUMENT_ONLY(release_curves(_pointers));
+}
+
+std::size_t CurveArena::size(void) const {return _curves.size();}
+
+const std::vector<const Curve*> &CurveArena::get_curves(void) const
+{
+    return _pointers;
+}
+
+void CurveArena::_point(void)
+{
+    _pointers.reserve(_curves.size());
+    for (CurveVariant &c: _curves) _pointers.push_back(get_curve(c));
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include "curves.h"
+
+class CurveArena
+{
+    /* Immutable storage for the curves of one model - a single contiguous
+    block of CurveVariant, filled once on construction. The curves never
+    move, so pointers to them stay valid as long as the arena lives. Fuzzy
+    Sets share an arena through std::shared_ptr, each set refers to a range
+    of it, so copying a set copies no curve. The curves are only handed out
+    as const, nothing can change them after construction, so sharing the
+    arena between sets and threads is safe. */
+    private:
+        std::vector<CurveVariant> _curves;
+        std::vector<const Curve*> _pointers;
+    public:
+        CurveArena(std::vector<CurveVariant> curves);
+        // Copies of the curves, the originals stay with the caller
+        CurveArena(const std::vector<Curve*> &curves);
+        ~CurveArena(void);
+        CurveArena(const CurveArena&) = delete;
+        CurveArena &operator=(const CurveArena&) = delete;
+        std::size_t size(void) const;
+        const std::vector<const Curve*> &get_curves(void) const;
+    private:
+        void _point(void);
+};
@@ -2,17 +2,33 @@
 #include "fuzzy.h"
 #include "json.hpp"
 #include <math.h>
+#include <cmath>
 #include <limits>
+#include <map>
+#include <stdexcept>
+#include <type_traits>
 
 #define GET_DOUBLE_VALUE(JSON, KEY) ((JSON.begin().value().at(KEY).get<double>()))
 
+/* Batch kernels call the scalar 'membership' non-virtually, so every element
+gets exactly the same expression as the scalar path while the loop body stays
+inlinable and (for the polynomial curves) vectorizable by the compiler. */
+template <typename T>
+void batch_membership(
+    const T *curve, const double *input, double *output, std::size_t count
+)
+{
+    for (std::size_t i = 0; i < count; i++)
+        output[i] = curve->T::membership(input[i]);
+}
+
 std::vector<CurveParameters> defined_curves(void)
 {
     return std::vector<CurveParameters>{
         {"ConstantCurve", {"value"}},
         {"LinearCurve", {"slope", "intercept"}},
         {"QuadraticCurve", {"a", "b", "c"}},
-        {"ExponentialCurve", {"base", "x_offset", "y_offset"}},
+        {"ExponentialCurve", {"base", "x_offset", "y_offset"}, {{"scale", 1}}},
         {"LogarithmicCurve", {"base", "x_offset", "y_offset"}}
     };
 }
@@ -26,40 +42,30 @@ _upper_inclusive(upper_unclusive), _lower_inclusive(lower_inclusive) {}
 
 Curve::Curve(const json &j)
 {
-    try
-    {
-        _lower_bound = j.begin().value().at("bounds").at("lower").get<double>();
-    }
-    catch(const json::out_of_range &e)
-    {
-        _lower_bound = - std::numeric_limits<double>::infinity();
-    }
-    try
-    {
-        _upper_bound = j.begin().value().at("bounds").at("upper").get<double>();
-    }
-    catch(const json::out_of_range &e)
-    {
-        _upper_bound = + std::numeric_limits<double>::infinity();
-    }
-    try
-    {
-        _upper_inclusive =
-            j.begin().value().at("bounds").at("upper_inclusive").get<bool>();
-    }
-    catch(const json::out_of_range &e) {}
-    try
-    {
-        _lower_inclusive =
-            j.begin().value().at("bounds").at("lower_inclusive").get<bool>();
-    }
-    catch(const json::out_of_range &e) {}
+    // Missing bounds are infinite, looked up without throwing
+    _lower_bound = - std::numeric_limits<double>::infinity();
+    _upper_bound = + std::numeric_limits<double>::infinity();
+    const json &curve = j.begin().value();
+    json::const_iterator bounds = curve.find("bounds");
+    if (bounds == curve.end()) return;
+    json::const_iterator value = bounds->find("lower");
+    if (value != bounds->end()) _lower_bound = value->get<double>();
+    value = bounds->find("upper");
+    if (value != bounds->end()) _upper_bound = value->get<double>();
+    value = bounds->find("upper_inclusive");
+    if (value != bounds->end()) _upper_inclusive = value->get<bool>();
+    value = bounds->find("lower_inclusive");
+    if (value != bounds->end()) _lower_inclusive = value->get<bool>();
 }
 
 double Curve::get_lower_bound(void) const {return _lower_bound;}
 
 double Curve::get_upper_bound(void) const {return _upper_bound;}
 
+bool Curve::get_lower_inclusive(void) const {return _lower_inclusive;}
+
+bool Curve::get_upper_inclusive(void) const {return _upper_inclusive;}
+
 void Curve::set_lower_bound(double value)
 {
     if (value > _upper_bound)
@@ -86,7 +92,16 @@ void Curve::set_upper_bound(double value)
     }
 }
 
-bool Curve::contains(double value)
+/* Integral of coefficient * x^n over [from, to]. Zero coefficient gives 0
+even over an infinite interval, otherwise an infinite bound gives an
+infinite (or NaN) result. */
+double power_integral(double coefficient, double from, double to, int n)
+{
+    if (coefficient == 0) return 0;
+    return coefficient * (pow(to, n + 1) - pow(from, n + 1)) / (n + 1);
+}
+
+bool Curve::contains(double value) const
 {
     bool result = false;
     if (_lower_inclusive) result = (_lower_bound <= value);
@@ -96,12 +111,12 @@ bool Curve::contains(double value)
     return result;
 }
 
-bool Curve::is_finite(void)
+bool Curve::is_finite(void) const
 {
     return isfinite(_lower_bound) && isfinite(_upper_bound);
 }
 
-json Curve::get_json(void)
+json Curve::get_json(void) const
 {
     json j = json::object();
     if (isfinite(_upper_bound))
@@ -132,7 +147,7 @@ ConstantCurve::ConstantCurve(const json &j): Curve(j)
     // _value = j.begin().value().at("value").get<double>();
 }
 
-Curve* ConstantCurve::clone(void)
+Curve* ConstantCurve::clone(void) const
 {
     return new ConstantCurve(
         _lower_bound, _upper_bound, _value,
@@ -140,14 +155,38 @@ Curve* ConstantCurve::clone(void)
     );
 }
 
-json ConstantCurve::get_json(void)
+json ConstantCurve::get_json(void) const
 {
     json j = Curve::get_json();
     j["value"] = _value;
     return json{{"ConstantCurve", j}};
 }
 
-double ConstantCurve::membership(double input) {return _value;}
+CurveType ConstantCurve::get_type(void) const {return CurveType::Constant;}
+
+std::vector<double> ConstantCurve::get_parameters(void) const
+{
+    return std::vector<double>{_value};
+}
+
+double ConstantCurve::curvature_bound(double, double) const
+{
+    return 0;
+}
+
+double ConstantCurve::moment(double from, double to, int k) const
+{
+    return power_integral(_value, from, to, k);
+}
+
+double ConstantCurve::membership(double input) const {return _value;}
+
+void ConstantCurve::membership(
+    const double *, double *output, std::size_t count
+) const
+{
+    for (std::size_t i = 0; i < count; i++) output[i] = _value;
+}
 
 LinearCurve::LinearCurve(void): Curve(), _slope(0), _intercept(0) {}
 
@@ -166,7 +205,7 @@ LinearCurve::LinearCurve(const json &j): Curve(j)
     // _intercept = j.begin().value().at("intercept").get<double>();
 }
 
-Curve* LinearCurve::clone(void)
+Curve* LinearCurve::clone(void) const
 {
     return new LinearCurve(
         _lower_bound, _upper_bound, _slope, _intercept,
@@ -174,7 +213,7 @@ Curve* LinearCurve::clone(void)
     );
 }
 
-json LinearCurve::get_json(void)
+json LinearCurve::get_json(void) const
 {
     json j = Curve::get_json();
     j["slope"] = _slope;
@@ -182,10 +221,35 @@ json LinearCurve::get_json(void)
     return json{{"LinearCurve", j}};
 }
 
-double LinearCurve::membership(double input)
+CurveType LinearCurve::get_type(void) const {return CurveType::Linear;}
+
+std::vector<double> LinearCurve::get_parameters(void) const
+{
+    return std::vector<double>{_slope, _intercept};
+}
+
+double LinearCurve::curvature_bound(double, double) const
+{
+    return 0;
+}
+
+double LinearCurve::moment(double from, double to, int k) const
+{
+    return power_integral(_slope, from, to, k + 1)
+        + power_integral(_intercept, from, to, k);
+}
+
+double LinearCurve::membership(double input) const
 {
     return _slope * input + _intercept;
 }
+void LinearCurve::membership(
+    const double *input, double *output, std::size_t count
+) const
+{
+    batch_membership(this, input, output, count);
+}
+
 
 QuadraticCurve::QuadraticCurve(void) :Curve(), _a(0), _b(0), _c(0) {}
 
@@ -203,7 +267,7 @@ QuadraticCurve::QuadraticCurve(const json &j): Curve(j)
     _c = GET_DOUBLE_VALUE(j, "c");
 }
 
-Curve* QuadraticCurve::clone(void)
+Curve* QuadraticCurve::clone(void) const
 {
     return new QuadraticCurve(
         _lower_bound, _upper_bound, _a, _b, _c,
@@ -211,17 +275,43 @@ Curve* QuadraticCurve::clone(void)
     );
 }
 
-json QuadraticCurve::get_json(void)
+json QuadraticCurve::get_json(void) const
 {
     json j = Curve::get_json();
     j["a"] = _a; j["b"] = _b; j["c"] = _c;
     return json{{"QuadraticCurve", j}};
 }
 
-double QuadraticCurve::membership(double input)
+CurveType QuadraticCurve::get_type(void) const {return CurveType::Quadratic;}
+
+std::vector<double> QuadraticCurve::get_parameters(void) const
+{
+    return std::vector<double>{_a, _b, _c};
+}
+
+double QuadraticCurve::curvature_bound(double, double) const
+{
+    return fabs(2 * _a);
+}
+
+double QuadraticCurve::moment(double from, double to, int k) const
+{
+    return power_integral(_a, from, to, k + 2)
+        + power_integral(_b, from, to, k + 1)
+        + power_integral(_c, from, to, k);
+}
+
+double QuadraticCurve::membership(double input) const
 {
     return _a*input*input + _b*input + _c;
 }
+void QuadraticCurve::membership(
+    const double *input, double *output, std::size_t count
+) const
+{
+    batch_membership(this, input, output, count);
+}
+
 
 LogarithmicCurve::LogarithmicCurve(void):
 Curve(), _base(M_E), _x_offset(0), _y_offset(0) {}
@@ -240,7 +330,7 @@ LogarithmicCurve::LogarithmicCurve(const json &j): Curve(j)
     _y_offset = GET_DOUBLE_VALUE(j, "y_offset");
 }
 
-Curve* LogarithmicCurve::clone(void)
+Curve* LogarithmicCurve::clone(void) const
 {
     return new LogarithmicCurve(
         _lower_bound, _upper_bound, _base,
@@ -249,7 +339,7 @@ Curve* LogarithmicCurve::clone(void)
     );
 }
 
-json LogarithmicCurve::get_json(void)
+json LogarithmicCurve::get_json(void) const
 {
     json j = Curve::get_json();
     j["base"] = _base; j["x_offset"] = _x_offset;
@@ -257,46 +347,289 @@ json LogarithmicCurve::get_json(void)
     return json{{"LogarithmicCurve", j}};
 }
 
-double LogarithmicCurve::membership(double input)
+CurveType LogarithmicCurve::get_type(void) const
+{
+    return CurveType::Logarithmic;
+}
+
+std::vector<double> LogarithmicCurve::get_parameters(void) const
+{
+    return std::vector<double>{_base, _x_offset, _y_offset};
+}
+
+double LogarithmicCurve::curvature_bound(double from, double) const
+{
+    // |y''| = 1 / ((x - x_offset)^2 * |ln(base)|) is largest at 'from'
+    double distance = from - _x_offset;
+    if (!(distance > 0)) return std::numeric_limits<double>::infinity();
+    return 1 / (distance * distance * fabs(log(_base)));
+}
+
+double LogarithmicCurve::moment(double from, double to, int k) const
+{
+    /* With u = x - x_offset: x^k = sum C(k, j) x_offset^(k - j) u^j and
+    the integral of u^j ln(u) is u^(j + 1) * (ln(u) / (j + 1) - 1 / (j + 1)^2),
+    which goes to 0 for u -> 0. */
+    const double u_from = from - _x_offset, u_to = to - _x_offset;
+    if (u_from < 0) return std::numeric_limits<double>::quiet_NaN();
+    auto antiderivative = [](double u, int j)
+    {
+        if (u == 0) return 0.0;
+        return pow(u, j + 1) * (log(u) / (j + 1) - 1.0 / ((j + 1) * (j + 1)));
+    };
+    double sum = 0, binomial = 1;
+    for (int j = 0; j <= k; j++)
+    {
+        double integral = antiderivative(u_to, j) - antiderivative(u_from, j);
+        sum += binomial * pow(_x_offset, k - j) * integral;
+        binomial = binomial * (k - j) / (j + 1);
+    }
+    return sum / log(_base) + power_integral(_y_offset, from, to, k);
+}
+
+double LogarithmicCurve::membership(double input) const
 {
     return log(input - _x_offset) / log(_base) + _y_offset;
 }
+void LogarithmicCurve::membership(
+    const double *input, double *output, std::size_t count
+) const
+{
+    batch_membership(this, input, output, count);
+}
 
 ExponentialCurve::ExponentialCurve(void):
-Curve(), _base(M_E), _x_offset(0), _y_offset(0) {}
+Curve(), _base(M_E), _x_offset(0), _y_offset(0), _scale(1) {}
 
 ExponentialCurve::ExponentialCurve(
     double lower_bound, double upper_bound,
     double base, double x_offset, double y_offset,
-    bool lower_inclusive, bool upper_unclusive
+    bool lower_inclusive, bool upper_unclusive, double scale
 ): Curve(lower_bound, upper_bound, lower_inclusive, upper_unclusive),
-_base(base), _x_offset(x_offset), _y_offset(y_offset) {}
+_base(base), _x_offset(x_offset), _y_offset(y_offset), _scale(scale) {}
 
 ExponentialCurve::ExponentialCurve(const json &j): Curve(j)
 {
     _base = GET_DOUBLE_VALUE(j, "base");
     _x_offset = GET_DOUBLE_VALUE(j, "x_offset");
     _y_offset = GET_DOUBLE_VALUE(j, "y_offset");
+    _scale = j.begin().value().value("scale", 1.0);
 }
 
-Curve* ExponentialCurve::clone(void)
+Curve* ExponentialCurve::clone(void) const
 {
     return new ExponentialCurve(
         _lower_bound, _upper_bound, _base,
         _x_offset, _y_offset,
-        _lower_inclusive, _upper_inclusive
+        _lower_inclusive, _upper_inclusive, _scale
     );
 }
 
-json ExponentialCurve::get_json(void)
+json ExponentialCurve::get_json(void) const
 {
     json j = Curve::get_json();
     j["base"] = _base; j["x_offset"] = _x_offset;
     j["y_offset"] = _y_offset;
+    if (_scale != 1) j["scale"] = _scale;
     return json{{"ExponentialCurve", j}};
 }
 
-double ExponentialCurve::membership(double input)
+CurveType ExponentialCurve::get_type(void) const
+{
+    return CurveType::Exponential;
+}
+
+std::vector<double> ExponentialCurve::get_parameters(void) const
+{
+    return std::vector<double>{_base, _x_offset, _y_offset, _scale};
+}
+
+double ExponentialCurve::curvature_bound(double from, double to) const
+{
+    // y'' = scale * ln(base)^2 * base^(x - x_offset) is monotonic
+    double ln_base = log(_base);
+    double largest = fmax(
+        pow(_base, from - _x_offset), pow(_base, to - _x_offset)
+    );
+    return fabs(_scale) * ln_base * ln_base * largest;
+}
+
+double ExponentialCurve::moment(double from, double to, int k) const
+{
+    /* With l = ln(base) the antiderivative of x^k * e^(l * (x - x_offset))
+    is e^(l * (x - x_offset)) * sum (-1)^j k! / (k - j)! x^(k - j) / l^(j + 1),
+    it vanishes at the infinite end where the exponential decays. */
+    const double l = log(_base);
+    if (l == 0) return power_integral(_scale + _y_offset, from, to, k);
+    auto antiderivative = [this, l, k](double x)
+    {
+        double e = exp(l * (x - _x_offset));
+        if (std::isinf(x) && e == 0) return 0.0;
+        double sum = 0, factor = 1 / l;
+        for (int j = 0; j <= k; j++)
+        {
+            sum += factor * pow(x, k - j);
+            factor *= -(k - j) / l;
+        }
+        return e * sum;
+    };
+    return _scale * (antiderivative(to) - antiderivative(from))
+        + power_integral(_y_offset, from, to, k);
+}
+
+double ExponentialCurve::membership(double input) const
+{
+    return _scale * pow(_base, (input - _x_offset)) +  _y_offset;
+}
+
+void ExponentialCurve::membership(
+    const double *input, double *output, std::size_t count
+) const
+{
+    batch_membership(this, input, output, count);
+}
+
+std::size_t sample_cells(
+    const Curve *curve, double from, double to,
+    double tolerance, std::size_t max_cells
+)
+{
+    if (max_cells < 1) max_cells = 1;
+    const double curvature = curve->curvature_bound(from, to);
+    if (!(tolerance > 0) || !std::isfinite(curvature)) return max_cells;
+    const double cells = ceil((to - from) * sqrt(curvature / (8 * tolerance)));
+    if (!(cells < max_cells)) return max_cells;
+    return cells < 1 ? 1 : cells;
+}
+
+void sample_curve(
+    const Curve *curve, double from, double to, std::size_t cells,
+    std::vector<double> &x, std::vector<double> &y
+)
+{
+    // From the index, so the last sample is exactly 'to'
+    const std::size_t start = x.size();
+    const double width = to - from;
+    x.resize(start + cells + 1);
+    y.resize(start + cells + 1);
+    for (std::size_t i = 0; i < cells; i++)
+        x[start + i] = from + width * i / cells;
+    x[start + cells] = to;
+    curve->membership(x.data() + start, y.data() + start, cells + 1);
+}
+
+template <typename R, typename T, typename... Args>
+R create_curve(const Args&... args)
+{
+    if constexpr (std::is_pointer<R>::value) return new T(args...);
+    else return T(args...);
+}
+
+template <typename R>
+std::vector<R> read_curves(const json &j)
+{
+    typedef R (*CurveResolver)(const json &j);
+    // Built once per curve representation
+    static const std::map<std::string, CurveResolver> resolver_map = {
+        {"ConstantCurve", create_curve<R, ConstantCurve>},
+        {"LinearCurve", create_curve<R, LinearCurve>},
+        {"QuadraticCurve", create_curve<R, QuadraticCurve>},
+        {"ExponentialCurve", create_curve<R, ExponentialCurve>},
+        {"LogarithmicCurve", create_curve<R, LogarithmicCurve>},
+    };
+    std::vector<R> result;
+    for (const json &element: j)
+    {
+        CurveResolver r = resolver_map.at(element.begin().key());
+        result.push_back(r(element));
+    }
+    return result;
+}
+
+std::vector<Curve*> curves_from_json(const json &j)
+{
+    return read_curves<Curve*>(j);
+}
+
+std::vector<CurveVariant> curve_variants_from_json(const json &j)
+{
+    return read_curves<CurveVariant>(j);
+}
+
+CurveVariant to_variant(const Curve *curve)
+{
+    switch (curve->get_type())
+    {
+        case CurveType::Constant:
+            return *static_cast<const ConstantCurve*>(curve);
+        case CurveType::Linear:
+            return *static_cast<const LinearCurve*>(curve);
+        case CurveType::Quadratic:
+            return *static_cast<const QuadraticCurve*>(curve);
+        case CurveType::Exponential:
+            return *static_cast<const ExponentialCurve*>(curve);
+        case CurveType::Logarithmic:
+            return *static_cast<const LogarithmicCurve*>(curve);
+    }
+    throw std::invalid_argument("Unknown curve type!");
+}
+
+Curve *get_curve(CurveVariant &curve)
+{
+    return std::visit([](auto &c) -> Curve* {return &c;}, curve);
+}
+
+template <typename R>
+R build_curve(
+    CurveType type, const std::vector<double> &p,
+    double l, double u, bool li, bool ui
+)
+{
+    switch (type)
+    {
+        case CurveType::Constant:
+            return create_curve<R, ConstantCurve>(l, u, p.at(0), li, ui);
+        case CurveType::Linear:
+            return create_curve<R, LinearCurve>(
+                l, u, p.at(0), p.at(1), li, ui
+            );
+        case CurveType::Quadratic:
+            return create_curve<R, QuadraticCurve>(
+                l, u, p.at(0), p.at(1), p.at(2), li, ui
+            );
+        case CurveType::Exponential:
+            return create_curve<R, ExponentialCurve>(
+                l, u, p.at(0), p.at(1), p.at(2), li, ui,
+                p.size() > 3 ? p[3] : 1
+            );
+        case CurveType::Logarithmic:
+            return create_curve<R, LogarithmicCurve>(
+                l, u, p.at(0), p.at(1), p.at(2), li, ui
+            );
+    }
+    throw std::invalid_argument("Unknown curve type!");
+}
+
+Curve *make_curve(
+    CurveType type, const std::vector<double> &parameters,
+    double lower_bound, double upper_bound,
+    bool lower_inclusive, bool upper_inclusive
+)
 {
-    return pow(_base, (input - _x_offset)) +  _y_offset;
-}
\ No newline at end of file
+    return build_curve<Curve*>(
+        type, parameters, lower_bound, upper_bound,
+        lower_inclusive, upper_inclusive
+    );
+}
+
+CurveVariant make_curve_variant(
+    CurveType type, const std::vector<double> &parameters,
+    double lower_bound, double upper_bound,
+    bool lower_inclusive, bool upper_inclusive
+)
+{
+    return build_curve<CurveVariant>(
+        type, parameters, lower_bound, upper_bound,
+        lower_inclusive, upper_inclusive
+    );
+}
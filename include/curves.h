@@ -1,18 +1,34 @@
 #pragma once
 
 #include <vector>
+#include <cstddef>
+#include <variant>
 #include "json.hpp"
 
 using json = nlohmann::json;
 
+typedef struct optional_parameter
+{
+    std::string name;
+    double default_value;
+} OptionalParameter;
+
 typedef struct curve_parameters
 {
     std::string name;
+    // Required in JSON, then the optional ones in the same parameter list
     std::vector<std::string> parameters;
+    std::vector<OptionalParameter> optional = {};
 } CurveParameters;
 
 std::vector<CurveParameters> defined_curves(void);
 
+// Tags of the concrete curve classes, in the order of 'defined_curves'
+enum class CurveType
+{
+    Constant, Linear, Quadratic, Exponential, Logarithmic
+};
+
 class Curve
 {
     /* Abstract base class representing one individual segment of
@@ -27,22 +43,36 @@ public:
         bool lower_inclusive = true, bool upper_unclusive = true
     );
     Curve(const json &j);
+    virtual ~Curve(void) {};
 
-    virtual Curve *clone(void) = 0;
+    virtual Curve *clone(void) const = 0;
 
     double get_lower_bound(void) const;
     double get_upper_bound(void) const;
+    bool get_lower_inclusive(void) const;
+    bool get_upper_inclusive(void) const;
     void set_lower_bound(double value);
     void set_upper_bound(double value);
 
-    bool contains(double value);
-    bool is_finite(void);
+    bool contains(double value) const;
+    bool is_finite(void) const;
 
-    virtual json get_json(void);
-    virtual double membership(double input) = 0;
+    virtual json get_json(void) const;
+    virtual CurveType get_type(void) const = 0;
+    // Parameters in the order listed by 'defined_curves'
+    virtual std::vector<double> get_parameters(void) const = 0;
+    // Largest |y''| on [from, to], infinity if undefined there
+    virtual double curvature_bound(double from, double to) const = 0;
+    // Integral of x^k * y(x) over [from, to], closed form, k >= 0
+    virtual double moment(double from, double to, int k) const = 0;
+    virtual double membership(double input) const = 0;
+    // Batch form of 'membership', ignores bounds of the curve
+    virtual void membership(
+        const double *input, double *output, std::size_t count
+    ) const = 0;
 };
 
-class ConstantCurve: public Curve
+class ConstantCurve final: public Curve
 {
     // y = value
     private:
@@ -54,12 +84,19 @@ class ConstantCurve: public Curve
             bool lower_inclusive = true, bool upper_unclusive = true
         );
         ConstantCurve(const json &j);
-        Curve *clone(void) override;
-        json get_json(void) override;
-        double membership(double input) override;
+        Curve *clone(void) const override;
+        json get_json(void) const override;
+        CurveType get_type(void) const override;
+        std::vector<double> get_parameters(void) const override;
+        double curvature_bound(double from, double to) const override;
+        double moment(double from, double to, int k) const override;
+        double membership(double input) const override;
+        void membership(
+            const double *input, double *output, std::size_t count
+        ) const override;
 };
 
-class LinearCurve: public Curve
+class LinearCurve final: public Curve
 {
     // y = slope * x + intercept
     private:
@@ -72,12 +109,19 @@ class LinearCurve: public Curve
             bool lower_inclusive = true, bool upper_unclusive = true
         );
         LinearCurve(const json &j);
-        Curve *clone(void) override;
-        json get_json(void) override;
-        double membership(double input) override;
+        Curve *clone(void) const override;
+        json get_json(void) const override;
+        CurveType get_type(void) const override;
+        std::vector<double> get_parameters(void) const override;
+        double curvature_bound(double from, double to) const override;
+        double moment(double from, double to, int k) const override;
+        double membership(double input) const override;
+        void membership(
+            const double *input, double *output, std::size_t count
+        ) const override;
 };
 
-class QuadraticCurve: public Curve
+class QuadraticCurve final: public Curve
 {
     // y = a*x^2 + b*x + c
     private:
@@ -92,12 +136,19 @@ class QuadraticCurve: public Curve
             bool lower_inclusive = true, bool upper_unclusive = true
         );
         QuadraticCurve(const json &j);
-        Curve *clone(void) override;
-        json get_json(void) override;
-        double membership(double input) override;
+        Curve *clone(void) const override;
+        json get_json(void) const override;
+        CurveType get_type(void) const override;
+        std::vector<double> get_parameters(void) const override;
+        double curvature_bound(double from, double to) const override;
+        double moment(double from, double to, int k) const override;
+        double membership(double input) const override;
+        void membership(
+            const double *input, double *output, std::size_t count
+        ) const override;
 };
 
-class LogarithmicCurve: public Curve
+class LogarithmicCurve final: public Curve
 {
     // y = log_'base'(x + 'x_offset') + 'y_offset'
     private:
@@ -111,26 +162,83 @@ class LogarithmicCurve: public Curve
             bool lower_inclusive = true, bool upper_unclusive = true
         );
         LogarithmicCurve(const json &j);
-        Curve *clone(void) override;
-        json get_json(void) override;
-        double membership(double input) override;
+        Curve *clone(void) const override;
+        json get_json(void) const override;
+        CurveType get_type(void) const override;
+        std::vector<double> get_parameters(void) const override;
+        double curvature_bound(double from, double to) const override;
+        double moment(double from, double to, int k) const override;
+        double membership(double input) const override;
+        void membership(
+            const double *input, double *output, std::size_t count
+        ) const override;
 };
 
-class ExponentialCurve: public Curve
+class ExponentialCurve final: public Curve
 {
-    // y = 'base'^(x + 'x_offset') + 'y_offset'
+    // y = 'scale' * 'base'^(x - 'x_offset') + 'y_offset'
     private:
         double _base;
         double _x_offset, _y_offset;
+        double _scale;  // optional in JSON, 1 when missing
     public:
         ExponentialCurve(void);
         ExponentialCurve(
             double lower_bound, double upper_bound,
             double base, double x_offset, double y_offset,
-            bool lower_inclusive = true, bool upper_unclusive = true
+            bool lower_inclusive = true, bool upper_unclusive = true,
+            double scale = 1
         );
         ExponentialCurve(const json &j);
-        Curve *clone(void) override;
-        json get_json(void) override;
-        double membership(double input) override;
-};
\ No newline at end of file
+        Curve *clone(void) const override;
+        json get_json(void) const override;
+        CurveType get_type(void) const override;
+        std::vector<double> get_parameters(void) const override;
+        double curvature_bound(double from, double to) const override;
+        double moment(double from, double to, int k) const override;
+        double membership(double input) const override;
+        void membership(
+            const double *input, double *output, std::size_t count
+        ) const override;
+};
+
+/* Curve stored by value. The concrete classes are final, so calls made on
+the alternative selected by std::visit are resolved statically. */
+typedef std::variant<
+    ConstantCurve, LinearCurve, QuadraticCurve,
+    ExponentialCurve, LogarithmicCurve
+> CurveVariant;
+
+CurveVariant to_variant(const Curve *curve);
+Curve *get_curve(CurveVariant &curve);
+
+// New curve of given type, 'parameters' in the order of 'get_parameters'
+Curve *make_curve(
+    CurveType type, const std::vector<double> &parameters,
+    double lower_bound, double upper_bound,
+    bool lower_inclusive = true, bool upper_inclusive = true
+);
+CurveVariant make_curve_variant(
+    CurveType type, const std::vector<double> &parameters,
+    double lower_bound, double upper_bound,
+    bool lower_inclusive = true, bool upper_inclusive = true
+);
+
+/* Cells of equal width on [from, to] such that straight lines between the
+samples stay within 'tolerance' of the curve, from the interpolation error
+bound h^2 / 8 * max|y''|. Lines and constants need a single cell. At most
+'max_cells', which is also used when the tolerance is not positive or the
+curvature is unknown. */
+std::size_t sample_cells(
+    const Curve *curve, double from, double to,
+    double tolerance, std::size_t max_cells
+);
+// Appends 'cells' + 1 samples of 'curve' on [from, to] to 'x' and 'y'
+void sample_curve(
+    const Curve *curve, double from, double to, std::size_t cells,
+    std::vector<double> &x, std::vector<double> &y
+);
+
+// Curve list in the JSON format used by FuzzySet, in either representation
+std::vector<Curve*> curves_from_json(const json &j);
+std::vector<CurveVariant> curve_variants_from_json(const json &j);
\ No newline at end of file
@@ -1,4 +1,7 @@
 #include "fuzzy.h"
+#include "sax_loader.h"
+#include "buffered_writer.h"
+#include "instrument.h"
 #include "json.hpp"
 #include <iostream>
 #include <fstream>
@@ -6,61 +9,218 @@
 #include <cmath>
 #include <math.h>
 #include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <memory>
+#include <utility>
+#include <charconv>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+
+FuzzySet::FuzzySet(void)
+{
+    // All empty sets share one
+    static const FuzzySet empty(
+        "", std::make_shared<CurveArena>(std::vector<CurveVariant>()), 0, 0
+    );
+    _data = empty._data;
+}
 
 FuzzySet::FuzzySet(const std::string name, const std::vector<Curve*> curves)
 {
-    _name = name; _curves = curves;
+    _attach(name, std::make_shared<CurveArena>(curves), 0, curves.size());
+    for (Curve *c: curves) delete c;
+}
+
+FuzzySet::FuzzySet(
+    const std::string name, std::shared_ptr<const CurveArena> arena,
+    std::size_t first, std::size_t count
+)
+{
+    _attach(name, std::move(arena), first, count);
 }
 
 FuzzySet::FuzzySet(const json &j)
 {
-    _name = j.begin().key();
-    _get_curves_from_json(j.begin().value());
+    std::vector<CurveVariant> curves =
+        curve_variants_from_json(j.begin().value());
+    const std::size_t count = curves.size();
+    _attach(
+        j.begin().key(), std::make_shared<CurveArena>(std::move(curves)),
+        0, count
+    );
 }
 
 FuzzySet::FuzzySet(const std::string name, const json &j_curves)
 {
-    _name = name;
-    _get_curves_from_json(j_curves);
+    std::vector<CurveVariant> curves = curve_variants_from_json(j_curves);
+    const std::size_t count = curves.size();
+    _attach(name, std::make_shared<CurveArena>(std::move(curves)), 0, count);
 }
 
-FuzzySet::FuzzySet(const FuzzySet& original)
+double FuzzySet::membership(double value) const
 {
-    _name = original._name;
-    for (Curve *c: original._curves) _curves.push_back(c->clone());
-    
+    int i = _data->index.find(value);
+    FUZZY_INSTRUMENT_ONLY(count_membership(1, i < 0));
+    if (i < 0) return 0;
+    FUZZY_INSTRUMENT_ONLY(count_evaluations(_data->curves[i], 1));
+    if (_tables && !(*_tables)[i].empty())
+        return (*_tables)[i].membership(value);
+    return _data->curves[i]->membership(value);
 }
 
-FuzzySet::~FuzzySet(void)
+void FuzzySet::membership(
+    const double *input, double *output, std::size_t count
+) const
 {
-    for (Curve *c : _curves) delete c;
+    /* Inputs are processed in blocks small enough to stay in L1 cache.
+    The owning curve of every input is looked up first, then each run of
+    consecutive inputs with the same owner goes through the batch kernel of
+    that curve in one call. Sensor data changes slowly, so runs are long. */
+    const std::size_t block = 256;
+    int owners[block];
+    const SegmentIndex &index = _data->index;
+    const std::vector<const Curve*> &curves = _data->curves;
+    const std::vector<CurveTable> *tables = _tables.get();
+    FUZZY_INSTRUMENT_ONLY(
+        LatencyTimer timer(Latency::Evaluate);
+        std::size_t outside = 0;
+    )
+
+    for (std::size_t start = 0; start < count; start += block)
+    {
+        const std::size_t n = std::min(block, count - start);
+        const double *in = input + start;
+        double *out = output + start;
+        for (std::size_t i = 0; i < n; i++) owners[i] = index.find(in[i]);
+
+        std::size_t run = 0;
+        for (std::size_t i = 1; i <= n; i++)
+        {
+            if (i < n && owners[i] == owners[run]) continue;
+            const int owner = owners[run];
+            FUZZY_INSTRUMENT_ONLY(
+                if (owner < 0) outside += i - run;
+                else count_evaluations(curves[owner], i - run);
+            )
+            if (owner < 0) std::fill(out + run, out + i, 0.0);
+            else if (tables && !(*tables)[owner].empty())
+                (*tables)[owner].membership(in + run, out + run, i - run);
+            else curves[owner]->membership(in + run, out + run, i - run);
+            run = i;
+        }
+    }
+    FUZZY_INSTRUMENT_ONLY(count_membership(count, outside));
 }
 
-double FuzzySet::membership(double value)
+std::vector<double> FuzzySet::membership(
+    const std::vector<double> &input
+) const
 {
-    for (Curve *c: _curves) if(c->contains(value)) return c->membership(value);
-    return 0;
+    std::vector<double> output(input.size());
+    membership(input.data(), output.data(), input.size());
+    return output;
 }
 
-std::string FuzzySet::get_name(void) {return _name;}
+void FuzzySet::enable_lut(double max_error, std::size_t max_table_size)
+{
+    // New tables, copies made earlier keep theirs
+    std::vector<CurveTable> tables;
+    for (const Curve *c: _data->curves)
+        tables.push_back(CurveTable(c, max_error, max_table_size));
+    _tables = std::make_shared<std::vector<CurveTable>>(std::move(tables));
+}
 
-void FuzzySet::generate_plot_data(
-    std::string filename, int samples,
-    double center_infinite, double lookahead_infinite
-)
+void FuzzySet::disable_lut(void) {_tables.reset();}
+
+bool FuzzySet::is_lut_enabled(void) const {return _tables != nullptr;}
+
+LutStatistics FuzzySet::get_lut_statistics(void) const
 {
-    std::ofstream output_file(filename, std::ios::trunc);
-    if (!output_file.good())
+    LutStatistics statistics;
+    if (!_tables) return statistics;
+    for (const CurveTable &t: *_tables)
     {
-        std::string message = "File " + filename + " can't be oppened!";
-        throw std::invalid_argument(message);
+        if (t.empty()) continue;
+        statistics.tables++;
+        statistics.bytes += t.get_bytes();
+        statistics.error = std::max(statistics.error, t.get_error());
+        statistics.error_bound =
+            std::max(statistics.error_bound, t.get_error_bound());
     }
+    return statistics;
+}
 
-    double from, to;
-    
-    #define RENDER(x) ((output_file << x << ";" << c->membership(x) << std::endl))
+const CurveTable *FuzzySet::get_table(std::size_t curve) const
+{
+    if (!_tables || (*_tables)[curve].empty()) return nullptr;
+    return &(*_tables)[curve];
+}
+
+double FuzzySet::moment(int k) const
+{
+    if (k < 0) throw std::invalid_argument("Moment order must be >= 0!");
+    const bool cacheable = k < static_cast<int>(_moments.size());
+    if (cacheable && (_moments_cached & (1u << k))) return _moments[k];
+
+    /* Integrates the curve owning each open piece of the index between
+    neighbouring breakpoints, so overlapping curves count once with the
+    same 'first match wins' rule as evaluation. Single points add nothing. */
+    double result = 0;
+    const std::vector<const Curve*> &curves = _data->curves;
+    if (!curves.empty() && _span() != 0)
+    {
+        const SegmentIndex &index = _data->index;
+        const std::vector<double> &breakpoints = index.get_breakpoints();
+        const double lower = _min_bound(), upper = _max_bound();
+        for (std::size_t i = 0; i <= breakpoints.size(); i++)
+        {
+            int owner = index.owner(2 * i);
+            if (owner < 0) continue;
+            double from = i > 0 ? breakpoints[i - 1] : lower;
+            double to = i < breakpoints.size() ? breakpoints[i] : upper;
+            result += curves[owner]->moment(from, to, k);
+        }
+    }
+    if (cacheable)
+    {
+        _moments[k] = result;
+        _moments_cached |= 1u << k;
+    }
+    return result;
+}
+
+double FuzzySet::area(void) const {return moment(0);}
+
+double FuzzySet::centroid(void) const
+{
+    double a = area(), m = moment(1);
+    if (!std::isfinite(a) || !std::isfinite(m) || a == 0)
+    {
+        std::string message = "Centroid of set '" + _data->name
+            + "' is undefined, its area is " + std::to_string(a) + "!";
+        throw std::domain_error(message);
+    }
+    return m / a;
+}
 
-    for (Curve *c: _curves)
+const std::string &FuzzySet::get_name(void) const {return _data->name;}
+
+const std::vector<const Curve*> &FuzzySet::get_curves(void) const
+{
+    return _data->curves;
+}
+
+const SegmentIndex &FuzzySet::get_index(void) const {return _data->index;}
+
+void FuzzySet::sample(
+    std::vector<double> &x, std::vector<double> &y, int samples,
+    double center_infinite, double lookahead_infinite, double tolerance
+) const
+{
+    double from, to;
+    for (const Curve *c: _data->curves)
     {
         if (isinf(c->get_lower_bound()))
         {
@@ -82,84 +242,177 @@ void FuzzySet::generate_plot_data(
                 to = c->get_upper_bound();
             }
         }
-        RENDER(from);
-        for (double i = from; i < to; i += (to - from) / samples) RENDER(i);
-        RENDER(to);
+        const std::size_t cells = sample_cells(
+            c, from, to, tolerance, std::max(samples, 1)
+        );
+        sample_curve(c, from, to, cells, x, y);
     }
+}
 
-    output_file.close();
+static void write_plot_csv(
+    BufferedWriter &writer,
+    const std::vector<double> &x, const std::vector<double> &y
+)
+{
+    // Longest row is two 24 character numbers
+    const std::size_t row = 64;
+    writer.write("x;membership\n");
+    for (std::size_t i = 0; i < x.size(); i++)
+    {
+        char *out = writer.reserve(row), *end = out + row;
+        out = std::to_chars(out, end, x[i]).ptr;
+        *out++ = ';';
+        out = std::to_chars(out, end, y[i]).ptr;
+        *out++ = '\n';
+        writer.commit(out);
+    }
 }
 
-json FuzzySet::get_json(void)
+static void write_plot_npy(
+    BufferedWriter &writer,
+    const std::vector<double> &x, const std::vector<double> &y
+)
 {
-    json j = json::array();
-    for (Curve* c: _curves) j.push_back(c->get_json());
-    return json{{_name, j}};
+    // Format version 1.0, data in the byte order of this machine
+    const std::uint16_t probe = 1;
+    unsigned char first;
+    std::memcpy(&first, &probe, 1);
+    std::string header = std::string("{'descr': '")
+        + (first == 1 ? '<' : '>') + "f8', 'fortran_order': False, "
+        + "'shape': (" + std::to_string(x.size()) + ", 2), }";
+    // Magic, version and length take 10 bytes, data starts at a multiple of 64
+    header += std::string(63 - (10 + header.size()) % 64, ' ') + '\n';
+    const std::size_t length = header.size();
+    const char prefix[10] = {
+        '\x93', 'N', 'U', 'M', 'P', 'Y', 1, 0,
+        static_cast<char>(length & 0xff), static_cast<char>(length >> 8)
+    };
+    writer.write(std::string(prefix, sizeof(prefix)) + header);
+    for (std::size_t i = 0; i < x.size(); i++)
+    {
+        char *out = writer.reserve(2 * sizeof(double));
+        std::memcpy(out, &x[i], sizeof(double));
+        std::memcpy(out + sizeof(double), &y[i], sizeof(double));
+        writer.commit(out + 2 * sizeof(double));
+    }
 }
 
-template <typename T> Curve* create_curve(json &j) {return new T(j);}
-typedef Curve* (*CurveResolver)(json &j);
+static bool is_npy_file(const std::string &filename)
+{
+    const std::string extension = ".npy";
+    return filename.size() >= extension.size() && filename.compare(
+        filename.size() - extension.size(), extension.size(), extension
+    ) == 0;
+}
 
-void FuzzySet::_get_curves_from_json(const json &j)
+void FuzzySet::generate_plot_data(
+    std::string filename, int samples,
+    double center_infinite, double lookahead_infinite, double tolerance
+) const
 {
-    std::map<const std::string, CurveResolver> resolver_map = {
-        {"ConstantCurve", create_curve<ConstantCurve>},
-        {"LinearCurve", create_curve<LinearCurve>},
-        {"QuadraticCurve", create_curve<QuadraticCurve>},
-        {"ExponentialCurve", create_curve<ExponentialCurve>},
-        {"LogarithmicCurve", create_curve<LogarithmicCurve>},
-    };
-    for (auto element: j)
+    FUZZY_INSTRUMENT_ONLY(LatencyTimer timer(Latency::Export));
+    std::vector<double> x, y;
+    sample(x, y, samples, center_infinite, lookahead_infinite, tolerance);
+
+    std::FILE *output_file = std::fopen(filename.c_str(), "wb");
+    if (!output_file)
+    {
+        std::string message = "File " + filename + " can't be oppened!";
+        throw std::invalid_argument(message);
+    }
+    try
     {
-        std::string s = element.begin().key();
-        CurveResolver r = resolver_map.at(element.begin().key());
-        _curves.push_back(r(element));
-        // auto c = resolver_map["LinearCurve"](element);
-        // _curves.push_back(resolver_map[element.begin().key()](element));
-        // if (element.begin().key() == "ConstantCurve")
-        // {
-        //     _curves.push_back(new ConstantCurve(element));
-        // }
-        // else if (element.begin().key() == "LinearCurve")
-        // {
-        //     _curves.push_back(new LinearCurve(element));
-        // }
+        // Large enough for the whole file in either format
+        BufferedWriter writer(
+            output_file, std::min<std::size_t>((x.size() + 2) * 64, 1 << 20)
+        );
+        if (is_npy_file(filename)) write_plot_npy(writer, x, y);
+        else write_plot_csv(writer, x, y);
+        writer.flush();
     }
+    catch (...)
+    {
+        std::fclose(output_file);
+        throw;
+    }
+    if (std::fclose(output_file) != 0)
+        throw std::runtime_error("Writing file " + filename + " failed!");
 }
 
-bool FuzzySet::_is_finite(void)
+json FuzzySet::get_json(void) const
 {
-    for (Curve *c: _curves) if(!(c->is_finite())) return false;
+    json j = json::array();
+    for (const Curve *c: _data->curves) j.push_back(c->get_json());
+    return json{{_data->name, j}};
+}
+
+void FuzzySet::_attach(
+    const std::string &name, std::shared_ptr<const CurveArena> arena,
+    std::size_t first, std::size_t count
+)
+{
+    if (first > arena->size() || count > arena->size() - first)
+        throw std::out_of_range(
+            "Curves of set '" + name + "' lie outside of its arena!"
+        );
+    const std::vector<const Curve*> &curves = arena->get_curves();
+    std::shared_ptr<SetData> data = std::make_shared<SetData>();
+    data->name = name;
+    data->curves.assign(
+        curves.begin() + first, curves.begin() + first + count
+    );
+    data->index = SegmentIndex(data->curves);
+    data->arena = std::move(arena);
+    _data = std::move(data);
+    _tables.reset();
+    _moments_cached = 0;
+}
+
+bool FuzzySet::_is_finite(void) const
+{
+    for (const Curve *c: _data->curves) if(!(c->is_finite())) return false;
     return true;
 }
 
-double FuzzySet::_min_bound(void)
+double FuzzySet::_min_bound(void) const
 {
-    if (_curves.size() == 0)
+    if (_data->curves.size() == 0)
         throw std::out_of_range("Trying to find limit of an empty set!");
 
     double min = std::numeric_limits<double>::infinity();
-    for (Curve *c: _curves)
+    for (const Curve *c: _data->curves)
     {
         if (c->get_lower_bound() < min) min = c->get_lower_bound();
     }
     return min;
 }
 
-double FuzzySet::_max_bound(void)
+double FuzzySet::_max_bound(void) const
 {
-    if (_curves.size() == 0)
+    if (_data->curves.size() == 0)
         throw std::out_of_range("Trying to find limit of an empty set!");
-    double max = std::numeric_limits<double>::infinity();
-    for (Curve *c: _curves)
+    double max = - std::numeric_limits<double>::infinity();
+    for (const Curve *c: _data->curves)
     {
-        if (c->get_lower_bound() > max) max = c->get_lower_bound();
+        if (c->get_upper_bound() > max) max = c->get_upper_bound();
     }
     return max;
 }
 
-double FuzzySet::_span(void)
+double FuzzySet::_span(void) const
 {
     if (!(_is_finite())) return std::numeric_limits<double>::infinity();
     return _max_bound() - _min_bound();
 }
+
+std::vector<FuzzySet> load_fuzzy_sets(std::string filename)
+{
+    FUZZY_INSTRUMENT_ONLY(LatencyTimer timer(Latency::Load));
+    std::ifstream input_file(filename);
+    if (!input_file.good())
+    {
+        std::string message = "Failed to open file '" + filename + "'!";
+        throw std::invalid_argument(message);
+    }
+    return parse_fuzzy_sets(input_file);
+}
\ No newline at end of file
@@ -5,34 +5,97 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include <array>
+#include <memory>
+#include <cstddef>
 
 #include "curves.h"
+#include "curve_arena.h"
+#include "segment_index.h"
+#include "lut.h"
 
 using json = nlohmann::json;
 
 class FuzzySet
 {
+    /* Curves live in a CurveArena shared with the other sets of the same
+    model. Everything fixed on construction is shared by the copies of a
+    set as well, so copying a set costs a few reference counts and no
+    allocation. Only the LUT switch and the moment cache are per copy. */
     private:
-        std::string _name = "";
-        std::vector<Curve*> _curves;
+        typedef struct set_data
+        {
+            std::string name;
+            std::shared_ptr<const CurveArena> arena;
+            // Range of the arena belonging to the set
+            std::vector<const Curve*> curves;
+            SegmentIndex index;
+        } SetData;
+        std::shared_ptr<const SetData> _data;
+        // One table per curve when LUT mode is on, null otherwise
+        std::shared_ptr<const std::vector<CurveTable>> _tables;
+        /* Low order moments, bit k of '_moments_cached' marks a valid one.
+        Filled by const calls, so a copy must not be shared between threads
+        computing moments. */
+        mutable std::array<double, 4> _moments;
+        mutable unsigned _moments_cached = 0;
     public:
-        FuzzySet(void) {};
-        FuzzySet(const FuzzySet&);
+        FuzzySet(void);
+        // Takes ownership of 'curves', copied to a new arena and deleted
         FuzzySet(const std::string name, const std::vector<Curve*> curves);
+        // Curves 'first' to 'first + count' of a shared arena
+        FuzzySet(
+            const std::string name, std::shared_ptr<const CurveArena> arena,
+            std::size_t first, std::size_t count
+        );
         FuzzySet(const std::string name, const json &j_curves);
         FuzzySet(const json &j);
-        ~FuzzySet(void);
-        double membership(double value);
-        std::string get_name(void);
+        double membership(double value) const;
+        void membership(
+            const double *input, double *output, std::size_t count
+        ) const;
+        std::vector<double> membership(const std::vector<double> &input) const;
+        void enable_lut(double max_error, std::size_t max_table_size = 65536);
+        void disable_lut(void);
+        bool is_lut_enabled(void) const;
+        LutStatistics get_lut_statistics(void) const;
+        // Table evaluating curve 'curve' in LUT mode, null when it has none
+        const CurveTable *get_table(std::size_t curve) const;
+        // Exact integrals of the membership function, cached per set
+        double moment(int k) const;
+        double area(void) const;
+        double centroid(void) const;
+        const std::string &get_name(void) const;
+        const std::vector<const Curve*> &get_curves(void) const;
+        const SegmentIndex &get_index(void) const;
+        /* Samples of every curve for plotting, curves with unbounded
+        ends are cut 'lookahead_infinite' past their finite bound or around
+        'center_infinite'. Each curve gets as few points as keep straight
+        lines within 'tolerance', 'samples' cells at most. */
+        void sample(
+            std::vector<double> &x, std::vector<double> &y,
+            int samples = 300, double center_infinite = 0,
+            double lookahead_infinite = 10, double tolerance = 1e-4
+        ) const;
+        /* Samples as CSV with an 'x;membership' header, or for file names
+        ending with '.npy' as a NumPy array of float64 with a row (x,
+        membership) per sample, which 'numpy.load' maps without parsing. */
         void generate_plot_data(
             std::string filename, int samples = 300,
-            double center_infinite = 0, double lookahead_infinite = 10
-        );
-        json get_json(void);
+            double center_infinite = 0, double lookahead_infinite = 10,
+            double tolerance = 1e-4
+        ) const;
+        json get_json(void) const;
     private:
-        void _get_curves_from_json(const json &j);
-        bool _is_finite(void);
-        double _min_bound(void);
-        double _max_bound(void);
-        double _span(void);
+        void _attach(
+            const std::string &name, std::shared_ptr<const CurveArena> arena,
+            std::size_t first, std::size_t count
+        );
+        bool _is_finite(void) const;
+        double _min_bound(void) const;
+        double _max_bound(void) const;
+        double _span(void) const;
 };
+
+// Reads all sets from a JSON file holding an array of sets
+std::vector<FuzzySet> load_fuzzy_sets(std::string filename);
@@ -0,0 +1,336 @@
+#include "instrument.h"
+#include "fuzzy.h"
+#include <fstream>
+#include <stdexcept>
+
+#ifdef FUZZY_INSTRUMENT
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+typedef std::atomic<std::uint64_t> Counter;
+
+// Only the owning thread writes a counter, others just read it
+void add_count(Counter &counter, std::uint64_t value)
+{
+    counter.store(
+        counter.load(std::memory_order_relaxed) + value,
+        std::memory_order_relaxed
+    );
+}
+
+std::uint64_t read_count(const Counter &counter)
+{
+    return counter.load(std::memory_order_relaxed);
+}
+
+/* Values below 2^sub_bits have a bucket each, above that every power of
+two is split into 2^sub_bits buckets. Longer latencies than 2^max_bits ns
+(about 18 minutes) go to the last bucket. */
+const int sub_bits = 5, max_bits = 40;
+const std::size_t sub_buckets = std::size_t(1) << sub_bits;
+const std::size_t bucket_count = (max_bits - sub_bits + 1) * sub_buckets;
+const std::size_t latency_count = 3;
+
+std::size_t latency_bucket(std::uint64_t value)
+{
+    const std::uint64_t largest = (std::uint64_t(1) << max_bits) - 1;
+    value = std::min(value, largest);
+    if (value < sub_buckets) return value;
+    int exponent = 63;
+    while (!(value >> exponent)) exponent--;
+    const std::size_t mantissa =
+        (value >> (exponent - sub_bits)) & (sub_buckets - 1);
+    return (exponent - sub_bits + 1) * sub_buckets + mantissa;
+}
+
+// Largest value falling into bucket 'index'
+std::uint64_t bucket_top(std::size_t index)
+{
+    if (index < sub_buckets) return index;
+    const int exponent = index / sub_buckets + sub_bits - 1;
+    const std::uint64_t mantissa = index % sub_buckets;
+    const int shift = exponent - sub_bits;
+    return ((sub_buckets + mantissa + 1) << shift) - 1;
+}
+
+typedef struct histogram
+{
+    Counter buckets[bucket_count] = {};
+    Counter count{0}, sum{0}, max{0};
+} Histogram;
+
+typedef struct curve_counters
+{
+    Counter evaluations{0};
+} CurveCounters;
+
+typedef struct counters
+{
+    Counter calls{0}, values{0}, outside{0};
+    // Evaluations by curves of arenas released since
+    Counter released{0};
+    /* Owner inserts and erases under the mutex, readers iterate under it.
+    'stale' holds curves of released arenas still in 'curves', the owner
+    erases them before it counts again, 'pending' tells it there are any. */
+    std::mutex mutex;
+    std::unordered_map<const Curve*, CurveCounters> curves;
+    std::unordered_set<const Curve*> stale;
+    std::atomic<bool> pending{false};
+    Histogram latency[latency_count];
+} Counters;
+
+// Totals of finished threads and the blocks of running ones
+std::mutex counter_registry_mutex;
+Counters retired_counters;
+std::vector<Counters*> counter_registry;
+
+// Adds 'from' into 'to', 'to' must not be written by another thread
+void merge_counters(Counters &to, Counters &from)
+{
+    add_count(to.calls, read_count(from.calls));
+    add_count(to.values, read_count(from.values));
+    add_count(to.outside, read_count(from.outside));
+    add_count(to.released, read_count(from.released));
+    {
+        std::lock_guard<std::mutex> lock(from.mutex);
+        for (auto &entry: from.curves)
+        {
+            const std::uint64_t n = read_count(entry.second.evaluations);
+            // Its address may belong to a curve of another arena by now
+            if (from.stale.count(entry.first)) add_count(to.released, n);
+            else add_count(to.curves[entry.first].evaluations, n);
+        }
+    }
+    for (std::size_t l = 0; l < latency_count; l++)
+    {
+        Histogram &h = to.latency[l];
+        const Histogram &f = from.latency[l];
+        for (std::size_t b = 0; b < bucket_count; b++)
+            if (std::uint64_t n = read_count(f.buckets[b]))
+                add_count(h.buckets[b], n);
+        add_count(h.count, read_count(f.count));
+        add_count(h.sum, read_count(f.sum));
+        h.max.store(std::max(read_count(h.max), read_count(f.max)));
+    }
+}
+
+class ThreadCounters
+{
+    // Block of the calling thread, registered while the thread runs
+    public:
+        Counters counters;
+        ThreadCounters(void)
+        {
+            std::lock_guard<std::mutex> lock(counter_registry_mutex);
+            counter_registry.push_back(&counters);
+        }
+        ~ThreadCounters(void)
+        {
+            std::lock_guard<std::mutex> lock(counter_registry_mutex);
+            merge_counters(retired_counters, counters);
+            counter_registry.erase(std::find(
+                counter_registry.begin(), counter_registry.end(), &counters
+            ));
+        }
+};
+
+Counters &local_counters(void)
+{
+    thread_local ThreadCounters block;
+    return block.counters;
+}
+
+// Moves counts of released curves to 'released', owner thread only
+void erase_stale(Counters &c)
+{
+    std::lock_guard<std::mutex> lock(c.mutex);
+    for (const Curve *curve: c.stale)
+    {
+        auto found = c.curves.find(curve);
+        add_count(c.released, read_count(found->second.evaluations));
+        c.curves.erase(found);
+    }
+    c.stale.clear();
+    c.pending.store(false, std::memory_order_relaxed);
+}
+
+CurveCounters &curve_counters(const Curve *curve)
+{
+    Counters &c = local_counters();
+    if (c.pending.load(std::memory_order_relaxed)) erase_stale(c);
+    auto found = c.curves.find(curve);
+    if (found != c.curves.end()) return found->second;
+    std::lock_guard<std::mutex> lock(c.mutex);
+    return c.curves[curve];
+}
+
+void count_membership(std::size_t values, std::size_t outside)
+{
+    Counters &c = local_counters();
+    add_count(c.calls, 1);
+    add_count(c.values, values);
+    add_count(c.outside, outside);
+}
+
+void count_evaluations(const Curve *curve, std::size_t values)
+{
+    add_count(curve_counters(curve).evaluations, values);
+}
+
+/* Totals of finished threads are written under the registry mutex only,
+so their entries go at once. Running threads may be counting into theirs,
+which are marked and left to the owner. The arena is freed only after this
+returns, so an owner counting a new curve at a reused address sees the
+mark first. */
+void release_curves(const std::vector<const Curve*> &curves)
+{
+    if (curves.empty()) return;
+    std::lock_guard<std::mutex> lock(counter_registry_mutex);
+    for (const Curve *curve: curves)
+    {
+        auto found = retired_counters.curves.find(curve);
+        if (found == retired_counters.curves.end()) continue;
+        add_count(
+            retired_counters.released, read_count(found->second.evaluations)
+        );
+        retired_counters.curves.erase(found);
+    }
+    for (Counters *c: counter_registry)
+    {
+        std::lock_guard<std::mutex> block_lock(c->mutex);
+        for (const Curve *curve: curves)
+            if (c->curves.count(curve)) c->stale.insert(curve);
+        if (!c->stale.empty())
+            c->pending.store(true, std::memory_order_relaxed);
+    }
+}
+
+void record_latency(Latency latency, std::chrono::nanoseconds duration)
+{
+    const std::uint64_t ns = std::max<std::int64_t>(duration.count(), 0);
+    const std::size_t index = static_cast<std::size_t>(latency);
+    Histogram &h = local_counters().latency[index];
+    add_count(h.buckets[latency_bucket(ns)], 1);
+    add_count(h.count, 1);
+    add_count(h.sum, ns);
+    if (ns > read_count(h.max)) h.max.store(ns, std::memory_order_relaxed);
+}
+
+json histogram_json(const Histogram &h)
+{
+    const std::uint64_t count = read_count(h.count);
+    json j = {{"count", count}};
+    if (count == 0) return j;
+    j["mean"] = double(read_count(h.sum)) / count;
+    j["max"] = read_count(h.max);
+    // Highest value of the bucket holding the quantile, as HdrHistogram
+    const std::map<std::string, double> quantiles = {
+        {"p50", 0.5}, {"p90", 0.9}, {"p99", 0.99}, {"p999", 0.999}
+    };
+    for (auto &q: quantiles)
+    {
+        const double rank = q.second * count;
+        std::uint64_t seen = 0;
+        for (std::size_t b = 0; b < bucket_count; b++)
+        {
+            seen += read_count(h.buckets[b]);
+            if (seen >= rank && seen > 0)
+            {
+                j[q.first] = std::min(bucket_top(b), read_count(h.max));
+                break;
+            }
+        }
+    }
+    return j;
+}
+
+json instrumentation_report(const std::vector<FuzzySet> &sets)
+{
+    Counters total;
+    std::size_t threads = 0;
+    {
+        std::lock_guard<std::mutex> lock(counter_registry_mutex);
+        merge_counters(total, retired_counters);
+        for (Counters *c: counter_registry) merge_counters(total, *c);
+        threads = counter_registry.size();
+    }
+
+    json curves = json::array();
+    CurveCounters other;
+    add_count(other.evaluations, read_count(total.released));
+    for (const FuzzySet &set: sets)
+        for (std::size_t i = 0; i < set.get_curves().size(); i++)
+        {
+            auto found = total.curves.find(set.get_curves()[i]);
+            if (found == total.curves.end()) continue;
+            const CurveCounters &c = found->second;
+            curves.push_back({
+                {"set", set.get_name()},
+                {"segment", i},
+                {"type", defined_curves()[
+                    static_cast<int>(set.get_curves()[i]->get_type())].name},
+                {"evaluations", read_count(c.evaluations)}
+            });
+            // Curves shared by several sets are reported once
+            total.curves.erase(found);
+        }
+    for (auto &entry: total.curves)
+        add_count(other.evaluations, read_count(entry.second.evaluations));
+
+    return {
+        {"enabled", true},
+        {"running_threads", threads},
+        {"membership", {
+            {"calls", read_count(total.calls)},
+            {"values", read_count(total.values)},
+            {"outside", read_count(total.outside)}
+        }},
+        {"curves", curves},
+        {"other_curves", {
+            {"evaluations", read_count(other.evaluations)}
+        }},
+        {"latency_ns", {
+            {"load", histogram_json(total.latency[0])},
+            {"evaluate", histogram_json(total.latency[1])},
+            {"export", histogram_json(total.latency[2])}
+        }}
+    };
+}
+
+#else
+
+void count_membership(std::size_t, std::size_t) {}
+void count_evaluations(const Curve*, std::size_t) {}
+void release_curves(const std::vector<const Curve*>&) {}
+void record_latency(Latency, std::chrono::nanoseconds) {}
+
+json instrumentation_report(const std::vector<FuzzySet>&)
+{
+    return {{"enabled", false}};
+}
+
+#endif
+
+LatencyTimer::LatencyTimer(Latency latency):
+_latency(latency), _start(std::chrono::steady_clock::now()) {}
+
+LatencyTimer::~LatencyTimer(void)
+{
+    record_latency(_latency, std::chrono::steady_clock::now() - _start);
+}
+
+void save_instrumentation_report(
+    const std::vector<FuzzySet> &sets, const std::string &filename
+)
+{
+    std::ofstream output_file(filename, std::ios::trunc);
+    if (!output_file.good())
+        throw std::invalid_argument("File " + filename + " can't be oppened!");
+    output_file << instrumentation_report(sets).dump(4) << std::endl;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstddef>
+
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+class Curve;
+class FuzzySet;
+
+/* Counters and latency histograms of the hot paths, compiled in only with
+FUZZY_INSTRUMENT defined (CMake option of the same name). Each thread
+counts into its own block, written by that thread alone, so counting needs
+no locks and no atomic read-modify-write. Blocks of finished threads are
+added to a common total. Reports sum all of them at the time of the call.
+
+Counted are calls of 'FuzzySet::membership' (and values evaluated by
+LinguisticVariable), evaluations that fall outside all segments and values
+evaluated by each curve. These are the outcomes of the segment lookup, so
+lookups are not counted apart. Neither is 'Curve::contains', which since
+the segment index only runs while an index is built.
+Curves are told apart by address. A CurveArena releases the counters of
+its curves when it is destroyed, their evaluations are then counted among
+the other curves, so a new curve at the same address starts from zero.
+Histograms of load, evaluate and export latency keep 2^5 buckets per power
+of two of nanoseconds, about 3 % precision, like HdrHistogram. */
+#ifdef FUZZY_INSTRUMENT
+#define FUZZY_INSTRUMENT_ONLY(...) __VA_ARGS__
+#else
+#define FUZZY_INSTRUMENT_ONLY(...)
+#endif
+
+enum class Latency {Load, Evaluate, Export};
+
+// 'values' evaluated in one call, 'outside' of them in no segment
+void count_membership(std::size_t values, std::size_t outside);
+void count_evaluations(const Curve *curve, std::size_t values);
+// Curves about to be destroyed, their addresses may be reused
+void release_curves(const std::vector<const Curve*> &curves);
+void record_latency(Latency latency, std::chrono::nanoseconds duration);
+
+class LatencyTimer
+{
+    // Records the time from construction to destruction
+    private:
+        Latency _latency;
+        std::chrono::steady_clock::time_point _start;
+    public:
+        LatencyTimer(Latency latency);
+        ~LatencyTimer(void);
+};
+
+/* Everything counted so far, curves of 'sets' are named by set and
+segment, other curves are summed up. Only '{"enabled": false}' when the
+instrumentation is compiled out. */
+json instrumentation_report(const std::vector<FuzzySet> &sets);
+void save_instrumentation_report(
+    const std::vector<FuzzySet> &sets, const std::string &filename
+);
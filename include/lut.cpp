@@ -0,0 +1,72 @@
+#include "lut.h"
+#include <cmath>
+#include <math.h>
+#include <stdexcept>
+#include <algorithm>
+
+CurveTable::CurveTable(
+    const Curve *curve, double max_error, std::size_t max_size
+)
+{
+    if (!(max_error > 0))
+        throw std::invalid_argument("Table error bound must be positive!");
+    CurveType type = curve->get_type();
+    if (type != CurveType::Exponential && type != CurveType::Logarithmic)
+        return;
+    if (!curve->is_finite()) return;
+
+    const double from = curve->get_lower_bound();
+    const double to = curve->get_upper_bound();
+    const double curvature = curve->curvature_bound(from, to);
+    if (!(to > from) || !std::isfinite(curvature)) return;
+
+    double cells = ceil((to - from) * sqrt(curvature / (8 * max_error)));
+    if (cells < 1) cells = 1;
+    if (cells > max_size) return;
+
+    const std::size_t n = cells;
+    const double step = (to - from) / n;
+    _from = from;
+    _inverse_step = n / (to - from);
+    _values.resize(n + 1);
+    for (std::size_t i = 0; i < n; i++)
+        _values[i] = curve->membership(from + step * i);
+    _values[n] = curve->membership(to);
+    _error_bound = step * step / 8 * curvature;
+
+    // Interpolation error peaks close to the middle of each cell
+    for (std::size_t i = 0; i < n; i++)
+    {
+        double x = from + step * (i + 0.5);
+        _error = std::max(_error, fabs(membership(x) - curve->membership(x)));
+    }
+}
+
+bool CurveTable::empty(void) const {return _values.empty();}
+
+double CurveTable::membership(double input) const
+{
+    const std::size_t last = _values.size() - 2;
+    double position = (input - _from) * _inverse_step;
+    if (position < 0) position = 0;
+    std::size_t i = position;
+    if (i > last) i = last;
+    double fraction = position - i;
+    return _values[i] + fraction * (_values[i + 1] - _values[i]);
+}
+
+void CurveTable::membership(
+    const double *input, double *output, std::size_t count
+) const
+{
+    for (std::size_t i = 0; i < count; i++) output[i] = membership(input[i]);
+}
+
+double CurveTable::get_error(void) const {return _error;}
+
+double CurveTable::get_error_bound(void) const {return _error_bound;}
+
+std::size_t CurveTable::get_bytes(void) const
+{
+    return _values.size() * sizeof(double);
+}
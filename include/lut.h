@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include "curves.h"
+
+typedef struct lut_statistics
+{
+    std::size_t tables = 0;     // curves evaluated through a table
+    std::size_t bytes = 0;      // memory taken by all tables
+    double error = 0;           // largest error measured at cell midpoints
+    double error_bound = 0;     // analytic bound of the interpolation error
+} LutStatistics;
+
+class CurveTable
+{
+    /* Samples of one curve over its finite bounds, evaluated by linear
+    interpolation. Interpolation error on a cell of width h is at most
+    h^2 / 8 * max|y''|, the cell width is chosen from 'curvature_bound' so
+    this stays under the requested error. Curves that are cheap to evaluate
+    exactly, unbounded ones and ones needing more than 'max_size' cells are
+    left without a table ('empty'). */
+    private:
+        double _from = 0, _inverse_step = 0;
+        std::vector<double> _values;
+        double _error = 0, _error_bound = 0;
+    public:
+        CurveTable(void) {};
+        CurveTable(const Curve *curve, double max_error, std::size_t max_size);
+        bool empty(void) const;
+        double membership(double input) const;
+        void membership(
+            const double *input, double *output, std::size_t count
+        ) const;
+        double get_error(void) const;
+        double get_error_bound(void) const;
+        std::size_t get_bytes(void) const;
+};
@@ -0,0 +1,154 @@
+#include "mamdani.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+MamdaniEngine::MamdaniEngine(
+    const std::vector<LinguisticVariable> inputs,
+    const std::vector<LinguisticVariable> outputs,
+    std::size_t resolution, Defuzzification method
+): _rules(inputs), _outputs(outputs), _resolution(resolution), _method(method)
+{
+    if (_resolution < 2)
+        throw std::invalid_argument("Resolution must be at least 2!");
+    for (const LinguisticVariable &v: _outputs)
+    {
+        if (!(v.get_lower() < v.get_upper()))
+        {
+            std::string message = "Output variable '" + v.get_name()
+                + "' needs a non-empty universe!";
+            throw std::invalid_argument(message);
+        }
+        std::vector<double> universe(_resolution);
+        double step = (v.get_upper() - v.get_lower()) / (_resolution - 1);
+        for (std::size_t k = 0; k < _resolution; k++)
+            universe[k] = v.get_lower() + step * k;
+        universe.back() = v.get_upper();
+
+        std::vector<std::vector<double>> samples;
+        for (const FuzzySet &set: v.get_sets())
+            samples.push_back(set.membership(universe));
+        _universes.push_back(universe);
+        _samples.push_back(samples);
+    }
+}
+
+void MamdaniEngine::add_rule(
+    const Condition &condition,
+    const std::string output, const std::string set
+)
+{
+    for (std::size_t o = 0; o < _outputs.size(); o++)
+    {
+        if (_outputs[o].get_name() != output) continue;
+        Consequent consequent = {o, _outputs[o].find(set)};
+        _rules.add(condition);
+        _consequents.push_back(consequent);
+        return;
+    }
+    throw std::out_of_range("Unknown output variable '" + output + "'!");
+}
+
+std::vector<double> MamdaniEngine::infer(const std::vector<double> &input) const
+{
+    if (input.size() != input_count())
+        throw std::invalid_argument("Wrong number of input values!");
+    std::vector<double> output(output_count());
+    infer(input.data(), 1, output.data());
+    return output;
+}
+
+void MamdaniEngine::infer(
+    const double *input, std::size_t rows, double *output
+) const
+{
+    // Scratch space shared by all rows of the batch
+    std::vector<double> terms(_rules.term_count()), stack;
+    std::vector<std::vector<double>> clip(_outputs.size());
+    for (std::size_t o = 0; o < _outputs.size(); o++)
+        clip[o].assign(_outputs[o].size(), 0);
+    std::vector<Consequent> fired;
+    std::vector<double> aggregate(_resolution);
+
+    for (std::size_t row = 0; row < rows; row++)
+    {
+        const double *in = input + row * input_count();
+        double *out = output + row * output_count();
+
+        _rules.fuzzify(in, terms.data());
+        fired.clear();
+        _rules.fire(terms.data(), stack, [&](std::size_t r, double strength)
+        {
+            const Consequent &c = _consequents[r];
+            double &level = clip[c.output][c.set];
+            if (level == 0) fired.push_back(c);
+            level = std::max(level, strength);
+        });
+
+        for (std::size_t o = 0; o < _outputs.size(); o++)
+        {
+            std::fill(aggregate.begin(), aggregate.end(), 0.0);
+            bool any = false;
+            for (const Consequent &c: fired)
+            {
+                if (c.output != o) continue;
+                const double level = clip[o][c.set];
+                const std::vector<double> &samples = _samples[o][c.set];
+                for (std::size_t k = 0; k < _resolution; k++)
+                    aggregate[k] = std::max(
+                        aggregate[k], std::min(level, samples[k])
+                    );
+                any = true;
+            }
+            out[o] = any ? _defuzzify(aggregate, o)
+                : std::numeric_limits<double>::quiet_NaN();
+        }
+        for (const Consequent &c: fired) clip[c.output][c.set] = 0;
+    }
+}
+
+void MamdaniEngine::infer(
+    const double *input, std::size_t rows, double *output,
+    ThreadPool &pool, std::size_t chunk
+) const
+{
+    pool.parallel_for(rows, chunk, [&](std::size_t begin, std::size_t end)
+    {
+        infer(
+            input + begin * input_count(), end - begin,
+            output + begin * output_count()
+        );
+    });
+}
+
+double MamdaniEngine::_defuzzify(
+    const std::vector<double> &aggregate, std::size_t output
+) const
+{
+    const std::vector<double> &universe = _universes[output];
+    if (_method == Defuzzification::MeanOfMaximum)
+    {
+        double maximum = *std::max_element(aggregate.begin(), aggregate.end());
+        if (!(maximum > 0)) return std::numeric_limits<double>::quiet_NaN();
+        double sum = 0;
+        std::size_t count = 0;
+        for (std::size_t k = 0; k < _resolution; k++)
+            if (aggregate[k] == maximum) {sum += universe[k]; count++;}
+        return sum / count;
+    }
+    double area = 0, moment = 0;
+    for (std::size_t k = 0; k < _resolution; k++)
+    {
+        area += aggregate[k];
+        moment += aggregate[k] * universe[k];
+    }
+    if (!(area > 0)) return std::numeric_limits<double>::quiet_NaN();
+    return moment / area;
+}
+
+std::size_t MamdaniEngine::input_count(void) const
+{
+    return _rules.input_count();
+}
+
+std::size_t MamdaniEngine::output_count(void) const {return _outputs.size();}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+#include "variable.h"
+#include "rules.h"
+#include "thread_pool.h"
+
+class MamdaniEngine
+{
+    /* Mamdani inference - rule strength clips (min) the consequent set,
+    clipped sets of one output are aggregated by max and the result is
+    defuzzified over the output universe sampled at 'resolution' points.
+    Rules with the same consequent clip it to the strongest of them, so
+    the cost of aggregation grows with the number of distinct fired
+    consequents, not with the number of rules. */
+    public:
+        enum class Defuzzification {Centroid, MeanOfMaximum};
+    private:
+        typedef struct consequent
+        {
+            std::size_t output, set;
+        } Consequent;
+
+        RuleBase _rules;
+        std::vector<LinguisticVariable> _outputs;
+        std::vector<Consequent> _consequents;
+        std::size_t _resolution;
+        Defuzzification _method;
+        // Sampled universe of each output and sampled memberships of its sets
+        std::vector<std::vector<double>> _universes;
+        std::vector<std::vector<std::vector<double>>> _samples;
+    public:
+        MamdaniEngine(
+            const std::vector<LinguisticVariable> inputs,
+            const std::vector<LinguisticVariable> outputs,
+            std::size_t resolution = 201,
+            Defuzzification method = Defuzzification::Centroid
+        );
+        void add_rule(
+            const Condition &condition,
+            const std::string output, const std::string set
+        );
+        std::vector<double> infer(const std::vector<double> &input) const;
+        /* Row-major batch - 'input' holds 'rows' vectors of all inputs,
+        'output' receives 'rows' vectors of all outputs. Outputs no rule
+        fired for, or whose fired sets are zero on the whole universe, are
+        NaN with either defuzzification. */
+        void infer(const double *input, std::size_t rows, double *output) const;
+        // Same, with chunks of rows run by 'pool'
+        void infer(
+            const double *input, std::size_t rows, double *output,
+            ThreadPool &pool, std::size_t chunk = 256
+        ) const;
+        std::size_t input_count(void) const;
+        std::size_t output_count(void) const;
+    private:
+        double _defuzzify(
+            const std::vector<double> &aggregate, std::size_t output
+        ) const;
+};
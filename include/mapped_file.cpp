@@ -0,0 +1,153 @@
+#include "mapped_file.h"
+#include <stdexcept>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string &path, Mode mode, std::uint64_t size):
+_mode(mode)
+{
+    const bool write = mode == Mode::Write;
+    HANDLE file = CreateFileA(
+        path.c_str(), write ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+        FILE_SHARE_READ, NULL, write ? CREATE_ALWAYS : OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, NULL
+    );
+    if (file == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("File " + path + " can't be oppened!");
+    _file = file;
+
+    if (!write)
+    {
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size))
+        {
+            CloseHandle(file);
+            throw std::runtime_error("File " + path + " can't be measured!");
+        }
+        size = file_size.QuadPart;
+    }
+    _size = size;
+    if (_size == 0) return;  // empty files can't be mapped
+    _mapping = CreateFileMappingA(
+        file, NULL, write ? PAGE_READWRITE : PAGE_READONLY,
+        DWORD(_size >> 32), DWORD(_size), NULL
+    );
+    if (!_mapping)
+    {
+        CloseHandle(file);
+        throw std::runtime_error("File " + path + " can't be mapped!");
+    }
+}
+
+MappedFile::~MappedFile(void)
+{
+    unmap();
+    if (_mapping) CloseHandle(_mapping);
+    CloseHandle(_file);
+}
+
+char *MappedFile::map(std::uint64_t offset, std::size_t length)
+{
+    unmap();
+    if (length == 0) return nullptr;
+    if (offset + length > _size)
+        throw std::out_of_range("Mapped window exceeds the file!");
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    const std::uint64_t start = offset - offset % info.dwAllocationGranularity;
+    _view_size = length + (offset - start);
+    _view = static_cast<char*>(MapViewOfFile(
+        _mapping, _mode == Mode::Write ? FILE_MAP_WRITE : FILE_MAP_READ,
+        DWORD(start >> 32), DWORD(start), _view_size
+    ));
+    if (!_view) throw std::runtime_error("Mapping file window failed!");
+    return _view + (offset - start);
+}
+
+void MappedFile::unmap(void)
+{
+    if (_view) UnmapViewOfFile(_view);
+    _view = nullptr;
+    _view_size = 0;
+}
+
+#else
+
+MappedFile::MappedFile(const std::string &path, Mode mode, std::uint64_t size):
+_mode(mode)
+{
+    const bool write = mode == Mode::Write;
+    _file = write ? open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644)
+        : open(path.c_str(), O_RDONLY);
+    if (_file < 0)
+        throw std::runtime_error("File " + path + " can't be oppened!");
+    if (write)
+    {
+        if (ftruncate(_file, off_t(size)) != 0)
+        {
+            close(_file);
+            throw std::runtime_error("File " + path + " can't be resized!");
+        }
+    }
+    else
+    {
+        struct stat status;
+        if (fstat(_file, &status) != 0)
+        {
+            close(_file);
+            throw std::runtime_error("File " + path + " can't be measured!");
+        }
+        size = status.st_size;
+    }
+    _size = size;
+}
+
+MappedFile::~MappedFile(void)
+{
+    unmap();
+    close(_file);
+}
+
+char *MappedFile::map(std::uint64_t offset, std::size_t length)
+{
+    unmap();
+    if (length == 0) return nullptr;
+    if (offset + length > _size)
+        throw std::out_of_range("Mapped window exceeds the file!");
+    const std::uint64_t page = sysconf(_SC_PAGESIZE);
+    const std::uint64_t start = offset - offset % page;
+    const bool write = _mode == Mode::Write;
+    _view_size = length + (offset - start);
+    void *view = mmap(
+        nullptr, _view_size, write ? PROT_READ | PROT_WRITE : PROT_READ,
+        MAP_SHARED, _file, off_t(start)
+    );
+    if (view == MAP_FAILED)
+    {
+        _view_size = 0;
+        throw std::runtime_error("Mapping file window failed!");
+    }
+    _view = static_cast<char*>(view);
+    // Windows are walked front to back once, read ahead aggressively
+    if (!write) madvise(_view, _view_size, MADV_SEQUENTIAL);
+    return _view + (offset - start);
+}
+
+void MappedFile::unmap(void)
+{
+    if (_view) munmap(_view, _view_size);
+    _view = nullptr;
+    _view_size = 0;
+}
+
+#endif
+
+std::uint64_t MappedFile::size(void) const {return _size;}
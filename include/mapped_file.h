@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+class MappedFile
+{
+    /* File accessed through a memory mapping of one window at a time, so
+    files much larger than memory (or the address space) can be processed
+    in pieces. Moving the window unmaps the previous one, which lets the
+    system drop its pages - resident memory stays around one window.
+    Windows may start at any offset, alignment to the mapping granularity
+    is handled here. Opening in 'Write' mode creates or truncates the file
+    to the given size. */
+    public:
+        enum class Mode {Read, Write};
+    private:
+        Mode _mode;
+        std::uint64_t _size = 0;
+        char *_view = nullptr;      // start of the aligned mapping
+        std::size_t _view_size = 0;
+#ifdef _WIN32
+        void *_file = nullptr;
+        void *_mapping = nullptr;
+#else
+        int _file = -1;
+#endif
+    public:
+        MappedFile(const std::string &path, Mode mode, std::uint64_t size = 0);
+        MappedFile(const MappedFile&) = delete;
+        MappedFile &operator=(const MappedFile&) = delete;
+        ~MappedFile(void);
+        // Maps bytes [offset, offset + length) and returns pointer to them
+        char *map(std::uint64_t offset, std::size_t length);
+        void unmap(void);
+        std::uint64_t size(void) const;
+};
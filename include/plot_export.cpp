@@ -0,0 +1,110 @@
+#include "plot_export.h"
+#include "buffered_writer.h"
+#include "instrument.h"
+#include <charconv>
+#include <cstdio>
+#include <algorithm>
+#include <set>
+#include <cctype>
+#include <stdexcept>
+
+std::vector<std::string> export_plot_data(
+    ThreadPool &pool, const std::vector<FuzzySet> &sets,
+    const std::string &prefix, const std::string &extension
+)
+{
+    std::vector<std::string> filenames;
+    // Compared without case, some file systems do not tell case apart
+    std::set<std::string> taken;
+    for (const FuzzySet &set: sets)
+    {
+        const std::string stem = prefix + set.get_name();
+        std::string filename = stem + extension;
+        for (int n = 2; ; n++)
+        {
+            std::string key = filename;
+            for (char &c: key) c = std::tolower(static_cast<unsigned char>(c));
+            if (taken.insert(key).second) break;
+            filename = stem + "_" + std::to_string(n) + extension;
+        }
+        filenames.push_back(filename);
+    }
+    pool.parallel_for(sets.size(), 1, [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; i++)
+            sets[i].generate_plot_data(filenames[i]);
+    });
+    return filenames;
+}
+
+// Set name as a CSV field, quoted when it holds a separator or a quote
+static std::string csv_field(const std::string &text)
+{
+    if (text.find_first_of(";\"\r\n") == std::string::npos) return text;
+    std::string field = "\"";
+    for (char c: text)
+    {
+        if (c == '"') field += '"';
+        field += c;
+    }
+    return field + "\"";
+}
+
+// Rows 'set;x;membership' of all samples of 'set'
+static std::string long_rows(const FuzzySet &set)
+{
+    std::vector<double> x, y;
+    set.sample(x, y);
+    const std::string name = csv_field(set.get_name()) + ";";
+    const std::size_t row = 64;
+    std::string text;
+    text.resize(x.size() * (name.size() + row));
+    char *out = &text[0];
+    for (std::size_t i = 0; i < x.size(); i++)
+    {
+        char *end = out + name.size() + row;
+        out = std::copy(name.begin(), name.end(), out);
+        out = std::to_chars(out, end, x[i]).ptr;
+        *out++ = ';';
+        out = std::to_chars(out, end, y[i]).ptr;
+        *out++ = '\n';
+    }
+    text.resize(out - text.data());
+    return text;
+}
+
+void export_combined_plot_data(
+    ThreadPool &pool, const std::vector<FuzzySet> &sets,
+    const std::string &filename
+)
+{
+    FUZZY_INSTRUMENT_ONLY(LatencyTimer timer(Latency::Export));
+    std::FILE *output_file = std::fopen(filename.c_str(), "wb");
+    if (!output_file)
+        throw std::invalid_argument("File " + filename + " can't be oppened!");
+    const std::size_t group = 256;
+    std::vector<std::string> text(std::min(group, sets.size()));
+    try
+    {
+        BufferedWriter writer(output_file, 1 << 20);
+        writer.write("set;x;membership\n");
+        for (std::size_t first = 0; first < sets.size(); first += group)
+        {
+            const std::size_t n = std::min(group, sets.size() - first);
+            pool.parallel_for(n, 1, [&](std::size_t begin, std::size_t end)
+            {
+                for (std::size_t i = begin; i < end; i++)
+                    text[i] = long_rows(sets[first + i]);
+            });
+            for (std::size_t i = 0; i < n; i++) writer.write(text[i]);
+        }
+        writer.flush();
+    }
+    catch (...)
+    {
+        std::fclose(output_file);
+        throw;
+    }
+    if (std::fclose(output_file) != 0)
+        throw std::runtime_error("Writing file " + filename + " failed!");
+}
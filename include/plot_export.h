@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "fuzzy.h"
+#include "thread_pool.h"
+
+/* File 'prefix + name + extension' per set as 'generate_plot_data' writes
+it, '.csv' or '.npy', sets are written by the threads of 'pool'. A set
+whose file name is taken by an earlier one, ignoring case, gets '_2', '_3'...
+after its name, so no file is overwritten. Returns the file names in the
+order of 'sets'. */
+std::vector<std::string> export_plot_data(
+    ThreadPool &pool, const std::vector<FuzzySet> &sets,
+    const std::string &prefix, const std::string &extension = ".csv"
+);
+/* Single long-format CSV with a 'set;x;membership' row per sample of
+'FuzzySet::sample'. Sets are formatted by the pool a group at a time and
+written in their order, so memory use does not grow with their number. */
+void export_combined_plot_data(
+    ThreadPool &pool, const std::vector<FuzzySet> &sets,
+    const std::string &filename
+);
@@ -0,0 +1,486 @@
+#include "render.h"
+#include "instrument.h"
+#include <cmath>
+#include <limits>
+#include <cstdint>
+#include <charconv>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+typedef struct plot_layout
+{
+    int width, height;
+    // Plot area in pixels, y grows downwards
+    double left, top, right, bottom;
+    double x_min, x_max, y_min, y_max;
+    // Samples of every set
+    std::vector<std::vector<double>> x, y;
+} PlotLayout;
+
+// Colors of the sets, the default cycle of matplotlib
+const unsigned char palette[10][3] = {
+    {0x1f, 0x77, 0xb4}, {0xff, 0x7f, 0x0e}, {0x2c, 0xa0, 0x2c},
+    {0xd6, 0x27, 0x28}, {0x94, 0x67, 0xbd}, {0x8c, 0x56, 0x4b},
+    {0xe3, 0x77, 0xc2}, {0x7f, 0x7f, 0x7f}, {0xbc, 0xbd, 0x22},
+    {0x17, 0xbe, 0xcf}
+};
+const double line_width = 1.5;
+
+static PlotLayout layout_plot(
+    const std::vector<FuzzySet> &sets, int width, int height
+)
+{
+    if (width < 100 || height < 100)
+        throw std::invalid_argument("Plot must be at least 100x100 pixels!");
+    PlotLayout p;
+    p.width = width;
+    p.height = height;
+    p.left = 60;
+    p.top = 40;
+    p.right = width - 20;
+    p.bottom = height - 50;
+    // Quarter of a pixel of the [0, 1] membership range
+    const double tolerance = 0.25 / (p.bottom - p.top);
+    const int cells = p.right - p.left;
+
+    const double infinity = std::numeric_limits<double>::infinity();
+    p.x_min = infinity;
+    p.x_max = -infinity;
+    p.y_min = 0;
+    p.y_max = 1;
+    p.x.resize(sets.size());
+    p.y.resize(sets.size());
+    for (std::size_t s = 0; s < sets.size(); s++)
+    {
+        sets[s].sample(p.x[s], p.y[s], cells, 0, 10, tolerance);
+        for (std::size_t i = 0; i < p.x[s].size(); i++)
+        {
+            p.x_min = std::min(p.x_min, p.x[s][i]);
+            p.x_max = std::max(p.x_max, p.x[s][i]);
+            if (!std::isfinite(p.y[s][i])) continue;
+            p.y_min = std::min(p.y_min, p.y[s][i]);
+            p.y_max = std::max(p.y_max, p.y[s][i]);
+        }
+    }
+    if (!(p.x_min < p.x_max))
+    {
+        // No samples at all, or all at one point
+        if (!std::isfinite(p.x_min)) p.x_min = p.x_max = 0;
+        p.x_min -= 1;
+        p.x_max += 1;
+    }
+    return p;
+}
+
+static double pixel_x(const PlotLayout &p, double x)
+{
+    return p.left + (x - p.x_min) / (p.x_max - p.x_min) * (p.right - p.left);
+}
+
+static double pixel_y(const PlotLayout &p, double y)
+{
+    return p.bottom - (y - p.y_min) / (p.y_max - p.y_min) * (p.bottom - p.top);
+}
+
+// Round values about 'count' steps apart covering [from, to]
+static std::vector<double> ticks(double from, double to, int count)
+{
+    std::vector<double> result;
+    const double raw = (to - from) / count;
+    if (!(raw > 0) || !std::isfinite(raw)) return result;
+    const double magnitude = pow(10, floor(log10(raw)));
+    const double n = raw / magnitude;
+    const double step = (n < 1.5 ? 1 : n < 3 ? 2 : n < 7 ? 5 : 10) * magnitude;
+    for (double k = ceil(from / step); k * step <= to + step * 1e-9; k++)
+        result.push_back(k * step + 0.0);
+    return result;
+}
+
+static std::string number(double value, std::chars_format format, int precision)
+{
+    char buffer[64];
+    char *end = std::to_chars(
+        buffer, buffer + sizeof(buffer), value, format, precision
+    ).ptr;
+    return std::string(buffer, end);
+}
+
+// Pixel coordinate in SVG, hundredths are below any visible difference
+static std::string coordinate(double value)
+{
+    return number(value, std::chars_format::fixed, 2);
+}
+
+static std::string label(double value)
+{
+    return number(value, std::chars_format::general, 6);
+}
+
+static std::string escape_xml(const std::string &text)
+{
+    std::string result;
+    for (char c: text)
+        switch (c)
+        {
+            case '&': result += "&amp;"; break;
+            case '<': result += "&lt;"; break;
+            case '>': result += "&gt;"; break;
+            case '"': result += "&quot;"; break;
+            default: result += c;
+        }
+    return result;
+}
+
+static std::string svg_color(std::size_t set)
+{
+    const unsigned char *color = palette[set % 10];
+    const char digits[] = "0123456789abcdef";
+    std::string result = "#";
+    for (int c = 0; c < 3; c++)
+    {
+        result += digits[color[c] >> 4];
+        result += digits[color[c] & 15];
+    }
+    return result;
+}
+
+static void write_file(const std::string &filename, const std::string &content)
+{
+    std::ofstream output_file(filename, std::ios::binary | std::ios::trunc);
+    if (!output_file.good())
+        throw std::invalid_argument("File " + filename + " can't be oppened!");
+    output_file.write(content.data(), content.size());
+    if (!output_file.good())
+        throw std::runtime_error("Writing file " + filename + " failed!");
+}
+
+void render_svg(
+    const std::vector<FuzzySet> &sets, const std::string &filename,
+    int width, int height
+)
+{
+    const PlotLayout p = layout_plot(sets, width, height);
+    const std::string w = std::to_string(width), h = std::to_string(height);
+    std::string svg = "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\""
+        + w + "\" height=\"" + h + "\" viewBox=\"0 0 " + w + " " + h
+        + "\" font-family=\"sans-serif\" font-size=\"12\">\n"
+        "<rect width=\"100%\" height=\"100%\" fill=\"white\"/>\n"
+        "<text x=\"" + coordinate(width / 2.0) + "\" y=\"24\" "
+        "text-anchor=\"middle\" font-size=\"16\">"
+        "Membership functions of fuzzy sets</text>\n";
+
+    // Grid with tick labels under and left of the plot area
+    const std::string grid = "\" stroke=\"#dddddd\"/>\n";
+    for (double t: ticks(p.x_min, p.x_max, 8))
+    {
+        const std::string x = coordinate(pixel_x(p, t));
+        svg += "<line x1=\"" + x + "\" y1=\"" + coordinate(p.top)
+            + "\" x2=\"" + x + "\" y2=\"" + coordinate(p.bottom) + grid;
+        svg += "<text x=\"" + x + "\" y=\"" + coordinate(p.bottom + 16)
+            + "\" text-anchor=\"middle\">" + label(t) + "</text>\n";
+    }
+    for (double t: ticks(p.y_min, p.y_max, 5))
+    {
+        const std::string y = coordinate(pixel_y(p, t));
+        svg += "<line x1=\"" + coordinate(p.left) + "\" y1=\"" + y
+            + "\" x2=\"" + coordinate(p.right) + "\" y2=\"" + y + grid;
+        svg += "<text x=\"" + coordinate(p.left - 6) + "\" y=\""
+            + coordinate(pixel_y(p, t) + 4) + "\" text-anchor=\"end\">"
+            + label(t) + "</text>\n";
+    }
+    svg += "<rect x=\"" + coordinate(p.left) + "\" y=\"" + coordinate(p.top)
+        + "\" width=\"" + coordinate(p.right - p.left) + "\" height=\""
+        + coordinate(p.bottom - p.top)
+        + "\" fill=\"none\" stroke=\"black\"/>\n";
+
+    // A polyline per run of finite samples
+    for (std::size_t s = 0; s < sets.size(); s++)
+    {
+        const std::string start = "<polyline fill=\"none\" stroke=\""
+            + svg_color(s) + "\" stroke-width=\"" + label(line_width)
+            + "\" stroke-linejoin=\"round\" points=\"";
+        bool open = false;
+        for (std::size_t i = 0; i < p.x[s].size(); i++)
+        {
+            if (!std::isfinite(p.y[s][i]))
+            {
+                if (open) svg += "\"/>\n";
+                open = false;
+                continue;
+            }
+            svg += open ? " " : start;
+            svg += coordinate(pixel_x(p, p.x[s][i])) + ","
+                + coordinate(pixel_y(p, p.y[s][i]));
+            open = true;
+        }
+        if (open) svg += "\"/>\n";
+    }
+
+    // Legend in the upper right corner, sets that do not fit are counted
+    const std::size_t fit = (p.bottom - p.top - 20) / 16;
+    std::size_t rows = sets.size();
+    if (rows > fit) rows = fit > 0 ? fit - 1 : 0;
+    const std::size_t more = sets.size() - rows;
+    std::size_t longest = 0;
+    for (std::size_t s = 0; s < rows; s++)
+        longest = std::max(longest, sets[s].get_name().size());
+    if (rows > 0)
+    {
+        const double box_width = 40 + 7 * std::max<std::size_t>(longest, 12);
+        const double x = p.right - 10 - box_width, y = p.top + 10;
+        svg += "<rect x=\"" + coordinate(x) + "\" y=\"" + coordinate(y)
+            + "\" width=\"" + coordinate(box_width) + "\" height=\""
+            + coordinate(16 * (rows + (more > 0)) + 8) + "\" fill=\"white\" "
+            "fill-opacity=\"0.8\" stroke=\"#cccccc\"/>\n";
+        for (std::size_t s = 0; s < rows; s++)
+        {
+            const std::string line_y = coordinate(y + 16 * s + 12);
+            svg += "<line x1=\"" + coordinate(x + 8) + "\" y1=\"" + line_y
+                + "\" x2=\"" + coordinate(x + 28) + "\" y2=\"" + line_y
+                + "\" stroke=\"" + svg_color(s) + "\" stroke-width=\""
+                + label(line_width) + "\"/>\n";
+            svg += "<text x=\"" + coordinate(x + 34) + "\" y=\""
+                + coordinate(y + 16 * s + 16) + "\">"
+                + escape_xml(sets[s].get_name()) + "</text>\n";
+        }
+        if (more > 0)
+            svg += "<text x=\"" + coordinate(x + 8) + "\" y=\""
+                + coordinate(y + 16 * rows + 16) + "\">... and "
+                + std::to_string(more) + " more</text>\n";
+    }
+
+    svg += "<text x=\"" + coordinate((p.left + p.right) / 2) + "\" y=\""
+        + coordinate(height - 12) + "\" text-anchor=\"middle\">"
+        "Input variable [...]</text>\n";
+    svg += "<text transform=\"translate(16,"
+        + coordinate((p.top + p.bottom) / 2) + ") rotate(-90)\" "
+        "text-anchor=\"middle\">"
+        "Membership function [-]</text>\n</svg>\n";
+    write_file(filename, svg);
+}
+
+typedef struct image
+{
+    int width, height;
+    std::vector<unsigned char> rgb;
+    // Coverage of the line being drawn and the pixels it touched
+    std::vector<float> coverage;
+    int from_x, from_y, to_x, to_y;
+} Image;
+
+static void blend(
+    Image &image, int x, int y, const unsigned char *color, double a
+)
+{
+    unsigned char *pixel = &image.rgb[3 * (std::size_t(y) * image.width + x)];
+    for (int c = 0; c < 3; c++)
+        pixel[c] = std::lround(pixel[c] + a * (color[c] - pixel[c]));
+}
+
+/* Adds a segment 'line_width' wide to the coverage, each pixel covered by
+how far its center is from the segment. Joined segments take the larger
+coverage, so the joints of a polyline are not drawn twice. */
+static void cover_segment(
+    Image &image, double x0, double y0, double x1, double y1
+)
+{
+    const double r = line_width / 2 + 0.5;
+    const int from_x = std::max(0, int(floor(std::min(x0, x1) - r)));
+    const int to_x =
+        std::min(image.width - 1, int(ceil(std::max(x0, x1) + r)));
+    const int from_y = std::max(0, int(floor(std::min(y0, y1) - r)));
+    const int to_y =
+        std::min(image.height - 1, int(ceil(std::max(y0, y1) + r)));
+    if (from_x > to_x || from_y > to_y) return;
+    image.from_x = std::min(image.from_x, from_x);
+    image.to_x = std::max(image.to_x, to_x);
+    image.from_y = std::min(image.from_y, from_y);
+    image.to_y = std::max(image.to_y, to_y);
+
+    const double dx = x1 - x0, dy = y1 - y0, length = dx * dx + dy * dy;
+    for (int y = from_y; y <= to_y; y++)
+        for (int x = from_x; x <= to_x; x++)
+        {
+            const double cx = x + 0.5, cy = y + 0.5;
+            double t = length > 0 ? ((cx - x0) * dx + (cy - y0) * dy) / length
+                : 0;
+            t = std::min(1.0, std::max(0.0, t));
+            const double ex = cx - x0 - t * dx, ey = cy - y0 - t * dy;
+            const double distance = sqrt(ex * ex + ey * ey);
+            const float a = std::min(1.0, std::max(0.0, r - distance));
+            float &c = image.coverage[std::size_t(y) * image.width + x];
+            c = std::max(c, a);
+        }
+}
+
+// Paints the collected coverage in 'color' and clears it
+static void paint(Image &image, const unsigned char *color)
+{
+    for (int y = image.from_y; y <= image.to_y; y++)
+        for (int x = image.from_x; x <= image.to_x; x++)
+        {
+            float &c = image.coverage[std::size_t(y) * image.width + x];
+            if (c > 0) blend(image, x, y, color, c);
+            c = 0;
+        }
+    image.from_x = image.width;
+    image.from_y = image.height;
+    image.to_x = image.to_y = -1;
+}
+
+static std::uint32_t crc32(const std::string &data)
+{
+    static const std::vector<std::uint32_t> table = []()
+    {
+        std::vector<std::uint32_t> t(256);
+        for (std::uint32_t n = 0; n < 256; n++)
+        {
+            std::uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            t[n] = c;
+        }
+        return t;
+    }();
+    std::uint32_t crc = 0xffffffffu;
+    for (unsigned char byte: data)
+        crc = table[(crc ^ byte) & 0xff] ^ (crc >> 8);
+    return crc ^ 0xffffffffu;
+}
+
+static void put_uint32(std::string &out, std::uint32_t value)
+{
+    for (int shift = 24; shift >= 0; shift -= 8)
+        out += static_cast<char>((value >> shift) & 0xff);
+}
+
+static void add_chunk(
+    std::string &png, const char *type, const std::string &data
+)
+{
+    put_uint32(png, data.size());
+    const std::string body = std::string(type, 4) + data;
+    png += body;
+    put_uint32(png, crc32(body));
+}
+
+static std::string encode_png(const Image &image)
+{
+    // Scanlines with filter type 0 (none)
+    const std::size_t row = 3 * std::size_t(image.width);
+    std::string raw;
+    raw.reserve((row + 1) * image.height);
+    for (int y = 0; y < image.height; y++)
+    {
+        raw += '\0';
+        raw.append(
+            reinterpret_cast<const char*>(image.rgb.data()) + y * row, row
+        );
+    }
+
+    // zlib stream of stored deflate blocks of at most 65535 bytes
+    std::string z = "\x78\x01";
+    for (std::size_t offset = 0; ; )
+    {
+        const std::size_t n = std::min<std::size_t>(65535, raw.size() - offset);
+        const bool last = offset + n == raw.size();
+        z += static_cast<char>(last);
+        z += static_cast<char>(n & 0xff);
+        z += static_cast<char>(n >> 8);
+        z += static_cast<char>(~n & 0xff);
+        z += static_cast<char>((~n >> 8) & 0xff);
+        z.append(raw, offset, n);
+        offset += n;
+        if (last) break;
+    }
+    // Adler-32, sums cannot overflow within 5552 bytes
+    std::uint32_t a = 1, b = 0;
+    for (std::size_t start = 0; start < raw.size(); start += 5552)
+    {
+        const std::size_t end = std::min<std::size_t>(start + 5552, raw.size());
+        for (std::size_t i = start; i < end; i++)
+        {
+            a += static_cast<unsigned char>(raw[i]);
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    put_uint32(z, (b << 16) | a);
+
+    std::string header;
+    put_uint32(header, image.width);
+    put_uint32(header, image.height);
+    // 8 bit RGB, deflate, no filtering beyond per line, no interlace
+    header += std::string("\x08\x02\x00\x00\x00", 5);
+    std::string png = "\x89PNG\r\n\x1a\n";
+    add_chunk(png, "IHDR", header);
+    add_chunk(png, "IDAT", z);
+    add_chunk(png, "IEND", "");
+    return png;
+}
+
+void render_png(
+    const std::vector<FuzzySet> &sets, const std::string &filename,
+    int width, int height
+)
+{
+    const PlotLayout p = layout_plot(sets, width, height);
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.rgb.assign(3 * std::size_t(width) * height, 255);
+    image.coverage.assign(std::size_t(width) * height, 0);
+    image.from_x = width;
+    image.from_y = height;
+    image.to_x = image.to_y = -1;
+
+    // Grid and frame on whole pixels, crisp without anti-aliasing
+    const unsigned char grid[3] = {0xdd, 0xdd, 0xdd}, black[3] = {0, 0, 0};
+    const int left = p.left, right = p.right, top = p.top, bottom = p.bottom;
+    for (double t: ticks(p.x_min, p.x_max, 8))
+        for (int y = top; y <= bottom; y++)
+            blend(image, int(pixel_x(p, t)), y, grid, 1);
+    for (double t: ticks(p.y_min, p.y_max, 5))
+        for (int x = left; x <= right; x++)
+            blend(image, x, int(pixel_y(p, t)), grid, 1);
+    for (int x = left; x <= right; x++)
+    {
+        blend(image, x, top, black, 1);
+        blend(image, x, bottom, black, 1);
+    }
+    for (int y = top; y <= bottom; y++)
+    {
+        blend(image, left, y, black, 1);
+        blend(image, right, y, black, 1);
+    }
+
+    for (std::size_t s = 0; s < sets.size(); s++)
+    {
+        const std::vector<double> &x = p.x[s], &y = p.y[s];
+        for (std::size_t i = 1; i < x.size(); i++)
+        {
+            if (!std::isfinite(y[i - 1]) || !std::isfinite(y[i])) continue;
+            cover_segment(image,
+                pixel_x(p, x[i - 1]), pixel_y(p, y[i - 1]),
+                pixel_x(p, x[i]), pixel_y(p, y[i])
+            );
+        }
+        paint(image, palette[s % 10]);
+    }
+    write_file(filename, encode_png(image));
+}
+
+void render_plot(
+    const std::vector<FuzzySet> &sets, const std::string &filename,
+    int width, int height
+)
+{
+    FUZZY_INSTRUMENT_ONLY(LatencyTimer timer(Latency::Export));
+    const std::string extension = ".png";
+    if (filename.size() >= extension.size() && filename.compare(
+        filename.size() - extension.size(), extension.size(), extension
+    ) == 0) render_png(sets, filename, width, height);
+    else render_svg(sets, filename, width, height);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "fuzzy.h"
+
+/* Plot of the membership functions of 'sets', drawn in process straight
+from their curves. Each set is sampled by 'FuzzySet::sample' with a
+tolerance of a quarter of a pixel and at most one cell per pixel of width,
+so straight lines between the samples are as exact as the drawing can
+show. The x range covers the samples of all sets, the y range spans [0, 1]
+and more where a curve leaves it. */
+void render_svg(
+    const std::vector<FuzzySet> &sets, const std::string &filename,
+    int width = 800, int height = 500
+);
+/* The same plot rasterized into an RGB PNG with anti-aliased lines. There
+is no font, so the image has the frame, grid and curves but no text. Image
+data is stored in uncompressed deflate blocks, no zlib is needed. */
+void render_png(
+    const std::vector<FuzzySet> &sets, const std::string &filename,
+    int width = 800, int height = 500
+);
+// PNG for file names ending with '.png', SVG otherwise
+void render_plot(
+    const std::vector<FuzzySet> &sets, const std::string &filename,
+    int width = 800, int height = 500
+);
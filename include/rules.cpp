@@ -0,0 +1,147 @@
+#include "rules.h"
+#include <algorithm>
+#include <stdexcept>
+
+Condition Condition::is(const std::string variable, const std::string set)
+{
+    Condition result;
+    result._program.push_back({Operation::Term, variable, set});
+    result._guarded = true;
+    result._guard = result._program.back();
+    return result;
+}
+
+Condition Condition::operator&(const Condition &other) const
+{
+    Condition result = *this;
+    result._program.insert(
+        result._program.end(), other._program.begin(), other._program.end()
+    );
+    result._program.push_back({Operation::And, "", ""});
+    if (!_guarded && other._guarded)
+    {
+        result._guarded = true;
+        result._guard = other._guard;
+    }
+    return result;
+}
+
+Condition Condition::operator|(const Condition &other) const
+{
+    Condition result = *this;
+    result._program.insert(
+        result._program.end(), other._program.begin(), other._program.end()
+    );
+    result._program.push_back({Operation::Or, "", ""});
+    result._guarded = false;
+    return result;
+}
+
+Condition Condition::operator!(void) const
+{
+    Condition result = *this;
+    result._program.push_back({Operation::Not, "", ""});
+    result._guarded = false;
+    return result;
+}
+
+const std::vector<Condition::Instruction> &Condition::get_program(void) const
+{
+    return _program;
+}
+
+bool Condition::is_guarded(void) const {return _guarded;}
+
+const Condition::Instruction &Condition::get_guard(void) const
+{
+    return _guard;
+}
+
+RuleBase::RuleBase(const std::vector<LinguisticVariable> inputs):
+_inputs(inputs)
+{
+    for (const LinguisticVariable &v: _inputs)
+    {
+        _offsets.push_back(_term_count);
+        _term_count += v.size();
+    }
+    _rules_by_guard.resize(_term_count);
+}
+
+std::size_t RuleBase::_term(const Condition::Instruction &instruction) const
+{
+    for (std::size_t v = 0; v < _inputs.size(); v++)
+    {
+        if (_inputs[v].get_name() != instruction.variable) continue;
+        return _offsets[v] + _inputs[v].find(instruction.set);
+    }
+    std::string message = "Unknown input variable '"
+        + instruction.variable + "'!";
+    throw std::out_of_range(message);
+}
+
+std::size_t RuleBase::add(const Condition &condition)
+{
+    if (condition.get_program().empty())
+        throw std::invalid_argument("Rule condition is empty!");
+    std::vector<CompiledInstruction> program;
+    for (const Condition::Instruction &i: condition.get_program())
+    {
+        std::size_t term = 0;
+        if (i.operation == Condition::Operation::Term) term = _term(i);
+        program.push_back({i.operation, term});
+    }
+    _programs.push_back(program);
+    std::size_t rule = _programs.size() - 1;
+    if (condition.is_guarded())
+        _rules_by_guard[_term(condition.get_guard())].push_back(rule);
+    else _unguarded.push_back(rule);
+    return rule;
+}
+
+std::size_t RuleBase::size(void) const {return _programs.size();}
+
+std::size_t RuleBase::input_count(void) const {return _inputs.size();}
+
+std::size_t RuleBase::term_count(void) const {return _term_count;}
+
+const std::vector<LinguisticVariable> &RuleBase::get_inputs(void) const
+{
+    return _inputs;
+}
+
+void RuleBase::fuzzify(const double *input, double *terms) const
+{
+    for (std::size_t v = 0; v < _inputs.size(); v++)
+        _inputs[v].membership(input[v], terms + _offsets[v]);
+}
+
+double RuleBase::_evaluate(
+    std::size_t rule, const double *terms, std::vector<double> &stack
+) const
+{
+    stack.clear();
+    for (const CompiledInstruction &i: _programs[rule])
+    {
+        switch (i.operation)
+        {
+            case Condition::Operation::Term:
+                stack.push_back(terms[i.term]);
+                break;
+            case Condition::Operation::And:
+                stack[stack.size() - 2] =
+                    std::min(stack[stack.size() - 2], stack.back());
+                stack.pop_back();
+                break;
+            case Condition::Operation::Or:
+                stack[stack.size() - 2] =
+                    std::max(stack[stack.size() - 2], stack.back());
+                stack.pop_back();
+                break;
+            case Condition::Operation::Not:
+                stack.back() = 1 - stack.back();
+                break;
+        }
+    }
+    return stack.back();
+}
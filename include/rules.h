@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+#include "variable.h"
+
+class Condition
+{
+    /* Antecedent of a fuzzy rule - terms 'variable is set' combined with
+    AND (min), OR (max) and NOT (1 - x). Built with 'is' and the operators
+    &, | and !, stored in postfix order so evaluation is a single pass. */
+    public:
+        enum class Operation {Term, And, Or, Not};
+        typedef struct instruction
+        {
+            Operation operation;
+            std::string variable, set;
+        } Instruction;
+    private:
+        std::vector<Instruction> _program;
+        // Term that must be non-zero for the whole condition to be non-zero
+        bool _guarded = false;
+        Instruction _guard;
+    public:
+        static Condition is(const std::string variable, const std::string set);
+        Condition operator&(const Condition &other) const;
+        Condition operator|(const Condition &other) const;
+        Condition operator!(void) const;
+        const std::vector<Instruction> &get_program(void) const;
+        bool is_guarded(void) const;
+        const Instruction &get_guard(void) const;
+};
+
+class RuleBase
+{
+    /* Rule antecedents linked to input variables. Terms are resolved to
+    positions in the flat vector of fuzzified inputs (memberships of all
+    sets of all inputs). Rules are indexed by their guard term, so only
+    rules whose guard has a non-zero membership are evaluated, the rest are
+    known to have zero firing strength. */
+    private:
+        typedef struct compiled_instruction
+        {
+            Condition::Operation operation;
+            std::size_t term;
+        } CompiledInstruction;
+
+        std::vector<LinguisticVariable> _inputs;
+        std::vector<std::size_t> _offsets;
+        std::size_t _term_count = 0;
+        std::vector<std::vector<CompiledInstruction>> _programs;
+        std::vector<std::vector<std::size_t>> _rules_by_guard;
+        std::vector<std::size_t> _unguarded;
+    public:
+        RuleBase(void) {};
+        RuleBase(const std::vector<LinguisticVariable> inputs);
+        std::size_t add(const Condition &condition);
+        std::size_t size(void) const;
+        std::size_t input_count(void) const;
+        std::size_t term_count(void) const;
+        const std::vector<LinguisticVariable> &get_inputs(void) const;
+        // Memberships of all input sets, 'terms' holds 'term_count()' items
+        void fuzzify(const double *input, double *terms) const;
+        /* Calls 'fired(rule, strength)' for every rule with non-zero
+        firing strength, 'stack' is scratch space reused between calls. */
+        template <class Fired>
+        void fire(
+            const double *terms, std::vector<double> &stack, Fired fired
+        ) const;
+    private:
+        std::size_t _term(const Condition::Instruction &instruction) const;
+        double _evaluate(
+            std::size_t rule, const double *terms, std::vector<double> &stack
+        ) const;
+};
+
+template <class Fired>
+void RuleBase::fire(
+    const double *terms, std::vector<double> &stack, Fired fired
+) const
+{
+    for (std::size_t r: _unguarded)
+    {
+        double strength = _evaluate(r, terms, stack);
+        if (strength > 0) fired(r, strength);
+    }
+    for (std::size_t t = 0; t < _term_count; t++)
+    {
+        if (!(terms[t] > 0)) continue;
+        for (std::size_t r: _rules_by_guard[t])
+        {
+            double strength = _evaluate(r, terms, stack);
+            if (strength > 0) fired(r, strength);
+        }
+    }
+}
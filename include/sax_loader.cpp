@@ -0,0 +1,301 @@
+#include "sax_loader.h"
+#include <limits>
+#include <stdexcept>
+#include <memory>
+#include <utility>
+
+// Curve names and their parameter names, built on first use
+static const std::vector<CurveParameters> &curve_types(void)
+{
+    static const std::vector<CurveParameters> types = defined_curves();
+    return types;
+}
+
+// Required parameters come first, optional ones follow
+static int parameter_index(int type, const std::string &name)
+{
+    const CurveParameters &parameters = curve_types()[type];
+    const std::vector<std::string> &names = parameters.parameters;
+    for (std::size_t i = 0; i < names.size(); i++)
+        if (names[i] == name) return i;
+    for (std::size_t i = 0; i < parameters.optional.size(); i++)
+        if (parameters.optional[i].name == name) return names.size() + i;
+    return -1;
+}
+
+std::vector<FuzzySet> &FuzzySetSax::get_sets(void)
+{
+    if (_state != State::Done) _unexpected("end of input");
+    return _sets;
+}
+
+void FuzzySetSax::_unexpected(const std::string &what) const
+{
+    throw std::invalid_argument("Unexpected " + what + " in fuzzy sets!");
+}
+
+/* Consumes events of a skipped value, 'opens' and 'closes' mark events
+starting or ending an object or array. */
+bool FuzzySetSax::_skipped(bool opens, bool closes)
+{
+    if (_skip_next)
+    {
+        _skip_next = false;
+        if (opens) _skip = 1;
+        return true;
+    }
+    if (_skip == 0) return false;
+    if (opens) _skip++;
+    if (closes) _skip--;
+    return true;
+}
+
+bool FuzzySetSax::null()
+{
+    if (!_skipped(false, false)) _unexpected("null");
+    return true;
+}
+
+bool FuzzySetSax::boolean(bool value)
+{
+    if (_skipped(false, false)) return true;
+    if (_state == State::Bounds && _key == "lower_inclusive")
+        _lower_inclusive = value;
+    else if (_state == State::Bounds && _key == "upper_inclusive")
+        _upper_inclusive = value;
+    else _unexpected("boolean");
+    return true;
+}
+
+bool FuzzySetSax::number_integer(number_integer_t value)
+{
+    return _skipped(false, false) || _number(value);
+}
+
+bool FuzzySetSax::number_unsigned(number_unsigned_t value)
+{
+    return _skipped(false, false) || _number(value);
+}
+
+bool FuzzySetSax::number_float(number_float_t value, const string_t &)
+{
+    return _skipped(false, false) || _number(value);
+}
+
+bool FuzzySetSax::_number(double value)
+{
+    if (_state == State::Body)
+    {
+        // Keys other than parameters are skipped, see 'key'
+        const int i = parameter_index(_type, _key);
+        if (i < 0) _unexpected("number for '" + _key + "'");
+        _parameters[i] = value;
+        _given[i] = true;
+    }
+    else if (_state == State::Bounds && _key == "lower") _lower = value;
+    else if (_state == State::Bounds && _key == "upper") _upper = value;
+    else _unexpected("number");
+    return true;
+}
+
+bool FuzzySetSax::string(string_t &value)
+{
+    if (!_skipped(false, false)) _unexpected("string '" + value + "'");
+    return true;
+}
+
+bool FuzzySetSax::binary(binary_t &)
+{
+    if (!_skipped(false, false)) _unexpected("binary value");
+    return true;
+}
+
+bool FuzzySetSax::start_object(std::size_t)
+{
+    if (_skipped(true, false)) return true;
+    const double infinity = std::numeric_limits<double>::infinity();
+    switch (_state)
+    {
+        case State::Sets:
+            _state = State::Set;
+            _named = _curves_read = false;
+            break;
+        case State::Curves:
+            _state = State::Curve;
+            _type = -1;
+            break;
+        case State::Curve:
+        {
+            // Body of the curve named by the first key
+            const CurveParameters &type = curve_types()[_type];
+            const std::size_t n =
+                type.parameters.size() + type.optional.size();
+            _state = State::Body;
+            _parameters.assign(n, 0);
+            _given.assign(n, false);
+            _lower = -infinity;
+            _upper = infinity;
+            _lower_inclusive = _upper_inclusive = false;
+            break;
+        }
+        case State::Body:
+            if (_key != "bounds") _unexpected("object");
+            _state = State::Bounds;
+            break;
+        default:
+            _unexpected("object");
+    }
+    return true;
+}
+
+bool FuzzySetSax::key(string_t &value)
+{
+    if (_skipped(false, false)) return true;
+    switch (_state)
+    {
+        case State::Set:
+            // Set name is the first key, others are ignored
+            if (_named)
+            {
+                _skip_next = true;
+                break;
+            }
+            _name = value;
+            _named = true;
+            break;
+        case State::Curve:
+            if (_type >= 0)
+            {
+                _skip_next = true;
+                break;
+            }
+            for (std::size_t i = 0; i < curve_types().size(); i++)
+                if (curve_types()[i].name == value) _type = i;
+            if (_type < 0)
+                throw std::invalid_argument(
+                    "Unknown curve type '" + value + "'!"
+                );
+            break;
+        case State::Body:
+            _key = value;
+            if (value != "bounds" && parameter_index(_type, value) < 0)
+                _skip_next = true;
+            break;
+        case State::Bounds:
+            _key = value;
+            if (value != "lower" && value != "upper"
+                && value != "lower_inclusive" && value != "upper_inclusive")
+                _skip_next = true;
+            break;
+        default:
+            _unexpected("key '" + value + "'");
+    }
+    return true;
+}
+
+bool FuzzySetSax::end_object()
+{
+    if (_skipped(false, true)) return true;
+    switch (_state)
+    {
+        case State::Bounds:
+            _state = State::Body;
+            break;
+        case State::Body:
+            _finish_curve();
+            _state = State::Curve;
+            break;
+        case State::Curve:
+            if (_type < 0) _unexpected("empty curve");
+            _state = State::Curves;
+            break;
+        case State::Set:
+            if (!_curves_read) _unexpected("set without curves");
+            // Curves read since the last set belong to this one
+            {
+                std::size_t first = 0;
+                if (!_ranges.empty())
+                    first = _ranges.back().first + _ranges.back().count;
+                _ranges.push_back({_name, first, _curves.size() - first});
+            }
+            _state = State::Sets;
+            break;
+        default:
+            _unexpected("end of object");
+    }
+    return true;
+}
+
+bool FuzzySetSax::start_array(std::size_t)
+{
+    if (_skipped(true, false)) return true;
+    if (_state == State::Start) _state = State::Sets;
+    else if (_state == State::Set && _named && !_curves_read)
+        _state = State::Curves;
+    else _unexpected("array");
+    return true;
+}
+
+bool FuzzySetSax::end_array()
+{
+    if (_skipped(false, true)) return true;
+    if (_state == State::Curves)
+    {
+        _curves_read = true;
+        _state = State::Set;
+    }
+    else if (_state == State::Sets)
+    {
+        _finish_sets();
+        _state = State::Done;
+    }
+    else _unexpected("end of array");
+    return true;
+}
+
+bool FuzzySetSax::parse_error(
+    std::size_t, const std::string &,
+    const nlohmann::detail::exception &e
+)
+{
+    throw std::invalid_argument(e.what());
+}
+
+void FuzzySetSax::_finish_curve(void)
+{
+    const CurveParameters &type = curve_types()[_type];
+    const std::size_t required = type.parameters.size();
+    for (std::size_t i = 0; i < _parameters.size(); i++)
+    {
+        if (_given[i]) continue;
+        if (i >= required)
+        {
+            _parameters[i] = type.optional[i - required].default_value;
+            continue;
+        }
+        throw std::invalid_argument("Curve '" + type.name
+            + "' is missing parameter '" + type.parameters[i] + "'!");
+    }
+    _curves.push_back(make_curve_variant(
+        static_cast<CurveType>(_type), _parameters, _lower, _upper,
+        _lower_inclusive, _upper_inclusive
+    ));
+}
+
+void FuzzySetSax::_finish_sets(void)
+{
+    std::shared_ptr<const CurveArena> arena =
+        std::make_shared<CurveArena>(std::move(_curves));
+    _sets.reserve(_ranges.size());
+    for (SetRange &range: _ranges)
+        _sets.emplace_back(range.name, arena, range.first, range.count);
+    _ranges.clear();
+}
+
+std::vector<FuzzySet> parse_fuzzy_sets(std::istream &input)
+{
+    // Streamed, the document is never held in memory as a whole
+    FuzzySetSax handler;
+    json::sax_parse(input, &handler);
+    return std::move(handler.get_sets());
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <istream>
+#include <cstddef>
+
+#include "json.hpp"
+#include "curves.h"
+#include "fuzzy.h"
+
+using json = nlohmann::json;
+
+class FuzzySetSax: public nlohmann::json_sax<json>
+{
+    /* Builds Fuzzy Sets straight from the events of the JSON parser, in
+    the format of 'FuzzySet::get_json' - an array of one-key objects
+    mapping set name to its list of curves. No DOM is built and valid
+    input raises no exceptions. Keys that are not used (and everything
+    under them) are skipped, like the DOM constructors ignore them.
+    Malformed models throw std::invalid_argument. Curves of all sets go to
+    one CurveArena, built when the input ends. */
+    private:
+        enum class State {Start, Sets, Set, Curves, Curve, Body, Bounds, Done};
+        State _state = State::Start;
+        // Depth of a skipped value, 'skip_next' skips the value of a key
+        std::size_t _skip = 0;
+        bool _skip_next = false;
+        std::string _key;
+
+        typedef struct set_range
+        {
+            std::string name;
+            std::size_t first, count;
+        } SetRange;
+        std::vector<SetRange> _ranges;
+        std::vector<FuzzySet> _sets;
+        std::string _name;
+        bool _named = false, _curves_read = false;
+        std::vector<CurveVariant> _curves;
+
+        // Curve being read, type -1 until its key is seen
+        int _type = -1;
+        std::vector<double> _parameters;
+        std::vector<bool> _given;
+        double _lower = 0, _upper = 0;
+        bool _lower_inclusive = false, _upper_inclusive = false;
+    public:
+        FuzzySetSax(void) {};
+        std::vector<FuzzySet> &get_sets(void);
+
+        bool null() override;
+        bool boolean(bool value) override;
+        bool number_integer(number_integer_t value) override;
+        bool number_unsigned(number_unsigned_t value) override;
+        bool number_float(number_float_t value, const string_t &s) override;
+        bool string(string_t &value) override;
+        bool binary(binary_t &value) override;
+        bool start_object(std::size_t elements) override;
+        bool key(string_t &value) override;
+        bool end_object() override;
+        bool start_array(std::size_t elements) override;
+        bool end_array() override;
+        bool parse_error(
+            std::size_t position, const std::string &token,
+            const nlohmann::detail::exception &e
+        ) override;
+    private:
+        bool _skipped(bool opens, bool closes);
+        bool _number(double value);
+        void _finish_curve(void);
+        void _finish_sets(void);
+        [[noreturn]] void _unexpected(const std::string &what) const;
+};
+
+// Reads an array of sets from 'input' through FuzzySetSax
+std::vector<FuzzySet> parse_fuzzy_sets(std::istream &input);
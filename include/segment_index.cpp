@@ -0,0 +1,74 @@
+#include "segment_index.h"
+#include <algorithm>
+#include <queue>
+#include <functional>
+
+SegmentIndex::SegmentIndex(const std::vector<const Curve*> &curves)
+{
+    for (const Curve *c: curves)
+    {
+        _breakpoints.push_back(c->get_lower_bound());
+        _breakpoints.push_back(c->get_upper_bound());
+    }
+    std::sort(_breakpoints.begin(), _breakpoints.end());
+    _breakpoints.erase(
+        std::unique(_breakpoints.begin(), _breakpoints.end()),
+        _breakpoints.end()
+    );
+
+    /* Every curve covers a run of consecutive pieces, from the point or
+    interval at its lower bound to the one at its upper bound. Sweeping the
+    pieces in order with the curves covering the current one in a min-heap,
+    the first of them is its owner. */
+    _owners.assign(2 * _breakpoints.size() + 1, -1);
+    std::vector<std::size_t> first(curves.size()), last(curves.size());
+    std::vector<int> order;
+    for (std::size_t c = 0; c < curves.size(); c++)
+    {
+        const std::size_t lower = std::lower_bound(_breakpoints.begin(),
+            _breakpoints.end(), curves[c]->get_lower_bound())
+            - _breakpoints.begin();
+        const std::size_t upper = std::lower_bound(_breakpoints.begin(),
+            _breakpoints.end(), curves[c]->get_upper_bound())
+            - _breakpoints.begin();
+        first[c] = 2 * lower + (curves[c]->get_lower_inclusive() ? 1 : 2);
+        last[c] = 2 * upper + (curves[c]->get_upper_inclusive() ? 1 : 0);
+        if (first[c] <= last[c]) order.push_back(c);
+    }
+    std::stable_sort(order.begin(), order.end(),
+        [&first](int a, int b) {return first[a] < first[b];});
+    std::priority_queue<int, std::vector<int>, std::greater<int>> covering;
+    std::size_t next = 0;
+    for (std::size_t p = 0; p < _owners.size(); p++)
+    {
+        while (next < order.size() && first[order[next]] <= p)
+            covering.push(order[next++]);
+        while (!covering.empty() && last[covering.top()] < p) covering.pop();
+        if (!covering.empty()) _owners[p] = covering.top();
+    }
+}
+
+std::size_t SegmentIndex::piece(double value) const
+{
+    // Number of breakpoints <= value, even pieces are open intervals
+    std::size_t i = std::upper_bound(
+        _breakpoints.begin(), _breakpoints.end(), value
+    ) - _breakpoints.begin();
+    if (i > 0 && _breakpoints[i - 1] == value) return 2 * i - 1;
+    return 2 * i;
+}
+
+int SegmentIndex::find(double value) const
+{
+    if (value != value) return -1;  // NaN is contained in no curve
+    return _owners[piece(value)];
+}
+
+int SegmentIndex::owner(std::size_t piece) const {return _owners[piece];}
+
+std::size_t SegmentIndex::piece_count(void) const {return _owners.size();}
+
+const std::vector<double> &SegmentIndex::get_breakpoints(void) const
+{
+    return _breakpoints;
+}
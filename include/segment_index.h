@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include "curves.h"
+
+class SegmentIndex
+{
+    /* Sorted table of all curve bounds of one Fuzzy Set. The bounds split
+    the real line into pieces - the bounds themselves and the open intervals
+    between them. No curve starts or ends inside a piece, so the first curve
+    containing any point of a piece contains the whole piece and is stored as
+    its owner. Finding the curve for a value is then a binary search for its
+    piece, with the same result as scanning curves until one contains it.
+    Building takes one sweep over the pieces, costing
+    O((curves + pieces) log curves). */
+    private:
+        std::vector<double> _breakpoints;
+        // 2 * breakpoints + 1 pieces, index of owning curve or -1 (none)
+        std::vector<int> _owners;
+    public:
+        SegmentIndex(void) {};
+        SegmentIndex(const std::vector<const Curve*> &curves);
+        int find(double value) const;
+        std::size_t piece(double value) const;
+        int owner(std::size_t piece) const;
+        std::size_t piece_count(void) const;
+        const std::vector<double> &get_breakpoints(void) const;
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <tuple>
+
+/* Fuzzy Sets declared at compile time. Curves are plain literal types and a
+set keeps them in a std::tuple, so a set definition needs no JSON parsing and
+no heap allocation and its evaluation is inlined into the caller. Semantics
+match FuzzySet - curves are tried in order and the first one containing the
+input gives the membership, inputs outside all curves give 0. Missing bounds
+default to infinity and exclusive, as in the JSON format. */
+
+namespace static_fuzzy
+{
+    constexpr double infinity = std::numeric_limits<double>::infinity();
+
+    struct Bounds
+    {
+        double lower = -infinity, upper = infinity;
+        bool lower_inclusive = false, upper_inclusive = false;
+
+        constexpr bool contains(double value) const
+        {
+            return (lower_inclusive ? lower <= value : lower < value)
+                && (upper_inclusive ? value <= upper : value < upper);
+        }
+    };
+
+    constexpr Bounds below(double upper, bool upper_inclusive = false)
+    {
+        return Bounds{-infinity, upper, false, upper_inclusive};
+    }
+
+    constexpr Bounds above(double lower, bool lower_inclusive = false)
+    {
+        return Bounds{lower, infinity, lower_inclusive, false};
+    }
+
+    constexpr Bounds between(
+        double lower, double upper,
+        bool lower_inclusive = false, bool upper_inclusive = false
+    )
+    {
+        return Bounds{lower, upper, lower_inclusive, upper_inclusive};
+    }
+
+    // Same expressions as 'membership' of the corresponding Curve classes
+    struct Constant
+    {
+        Bounds bounds;
+        double value;
+        constexpr double membership(double) const {return value;}
+    };
+
+    struct Linear
+    {
+        Bounds bounds;
+        double slope, intercept;
+        constexpr double membership(double input) const
+        {
+            return slope * input + intercept;
+        }
+    };
+
+    struct Quadratic
+    {
+        Bounds bounds;
+        double a, b, c;
+        constexpr double membership(double input) const
+        {
+            return a*input*input + b*input + c;
+        }
+    };
+
+    struct Exponential
+    {
+        Bounds bounds;
+        double base, x_offset, y_offset;
+        double scale = 1;
+        double membership(double input) const
+        {
+            return scale * std::pow(base, (input - x_offset)) + y_offset;
+        }
+    };
+
+    struct Logarithmic
+    {
+        Bounds bounds;
+        double base, x_offset, y_offset;
+        double membership(double input) const
+        {
+            return std::log(input - x_offset) / std::log(base) + y_offset;
+        }
+    };
+
+    template <class... Curves>
+    class Set
+    {
+        private:
+            std::tuple<Curves...> _curves;
+        public:
+            constexpr Set(Curves... curves): _curves(curves...) {}
+
+            double membership(double value) const
+            {
+                double result = 0;
+                // Short-circuiting fold stops at the first containing curve
+                std::apply([&](const Curves&... curve)
+                {
+                    (void)((curve.bounds.contains(value)
+                        && (result = curve.membership(value), true)) || ...);
+                }, _curves);
+                return result;
+            }
+
+            static constexpr std::size_t size(void)
+            {
+                return sizeof...(Curves);
+            }
+    };
+
+    template <class... Curves>
+    constexpr Set<Curves...> make_set(Curves... curves)
+    {
+        return Set<Curves...>(curves...);
+    }
+}
@@ -0,0 +1,89 @@
+#include "sugeno.h"
+#include <limits>
+#include <stdexcept>
+#include <algorithm>
+
+SugenoEngine::SugenoEngine(const std::vector<LinguisticVariable> inputs):
+_rules(inputs) {}
+
+void SugenoEngine::add_rule(const Condition &condition, double constant)
+{
+    add_rule(condition, std::vector<double>(input_count(), 0), constant);
+}
+
+void SugenoEngine::add_rule(
+    const Condition &condition,
+    const std::vector<double> coefficients, double constant
+)
+{
+    if (coefficients.size() != input_count())
+        throw std::invalid_argument("Wrong number of rule coefficients!");
+    _rules.add(condition);
+    _coefficients.push_back(constant);
+    _coefficients.insert(
+        _coefficients.end(), coefficients.begin(), coefficients.end()
+    );
+}
+
+double SugenoEngine::infer(const std::vector<double> &input) const
+{
+    if (input.size() != input_count())
+        throw std::invalid_argument("Wrong number of input values!");
+    double output;
+    _infer_rows(input.data(), 1, &output);
+    return output;
+}
+
+void SugenoEngine::infer(
+    const double *input, std::size_t rows, double *output, unsigned threads
+) const
+{
+    if (threads <= 1 || rows < 2)
+    {
+        _infer_rows(input, rows, output);
+        return;
+    }
+    ThreadPool pool(threads);
+    infer(input, rows, output, pool);
+}
+
+void SugenoEngine::infer(
+    const double *input, std::size_t rows, double *output,
+    ThreadPool &pool, std::size_t chunk
+) const
+{
+    pool.parallel_for(rows, chunk, [&](std::size_t begin, std::size_t end)
+    {
+        _infer_rows(input + begin * input_count(), end - begin, output + begin);
+    });
+}
+
+void SugenoEngine::_infer_rows(
+    const double *input, std::size_t rows, double *output
+) const
+{
+    const std::size_t n = input_count();
+    std::vector<double> terms(_rules.term_count()), stack;
+
+    for (std::size_t row = 0; row < rows; row++)
+    {
+        const double *in = input + row * n;
+        double weights = 0, sum = 0;
+        _rules.fuzzify(in, terms.data());
+        _rules.fire(terms.data(), stack, [&](std::size_t r, double strength)
+        {
+            const double *k = &_coefficients[r * (n + 1)];
+            double z = k[0];
+            for (std::size_t i = 0; i < n; i++) z += k[i + 1] * in[i];
+            weights += strength;
+            sum += strength * z;
+        });
+        output[row] = weights > 0 ? sum / weights
+            : std::numeric_limits<double>::quiet_NaN();
+    }
+}
+
+std::size_t SugenoEngine::input_count(void) const
+{
+    return _rules.input_count();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include "variable.h"
+#include "rules.h"
+#include "thread_pool.h"
+
+class SugenoEngine
+{
+    /* Takagi-Sugeno inference - every rule has a crisp consequent
+    z = c + k_1 * x_1 + ... + k_n * x_n and the output is the average of the
+    consequents weighted by rule firing strengths. There is no output
+    universe to aggregate or defuzzify. */
+    private:
+        RuleBase _rules;
+        // Per rule: the constant followed by one coefficient per input
+        std::vector<double> _coefficients;
+    public:
+        SugenoEngine(const std::vector<LinguisticVariable> inputs);
+        void add_rule(const Condition &condition, double constant);
+        void add_rule(
+            const Condition &condition,
+            const std::vector<double> coefficients, double constant
+        );
+        double infer(const std::vector<double> &input) const;
+        /* 'input' is a row-major matrix of 'rows' input vectors, 'output'
+        gets one value per row, NaN when no rule fired. With more than one
+        thread the rows are split into chunks run by a temporary pool. */
+        void infer(
+            const double *input, std::size_t rows, double *output,
+            unsigned threads = 1
+        ) const;
+        void infer(
+            const double *input, std::size_t rows, double *output,
+            ThreadPool &pool, std::size_t chunk = 1024
+        ) const;
+        std::size_t input_count(void) const;
+    private:
+        void _infer_rows(
+            const double *input, std::size_t rows, double *output
+        ) const;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "static_set.hpp"
+
+/* Compile-time copies of the sets in 'temperature_low.json' and
+'temperature_high.json'. Keep in sync with the JSON files. */
+
+namespace temperature
+{
+    using namespace static_fuzzy;
+
+    constexpr auto Freezing = make_set(
+        Constant{below(-15), 1},
+        Linear{between(-15, 10, true, true), -0.04, 0.4},
+        Constant{above(10), 0}
+    );
+
+    constexpr auto Cold = make_set(
+        Constant{below(0, true), 1},
+        Quadratic{between(0, 3.2824, false, true), -0.013, 0, 1},
+        Linear{between(3.2824, 11.7176, false, true), -0.08534, 1.1401},
+        Quadratic{between(11.7176, 15, false, true), 0.013, -0.39, 2.925},
+        Constant{above(15), 0}
+    );
+
+    constexpr auto Warm = make_set(
+        Exponential{between(5, 25, false, true), 1.035, 6.2, -0.915},
+        Constant{above(25), 1}
+    );
+
+    constexpr auto OK = make_set(
+        Quadratic{between(15, 30, false, true), -0.017778, 0.8, -8}
+    );
+
+    constexpr auto Hot = make_set(
+        Logarithmic{between(20, 32, true, true), 13.5, 19, 0},
+        Constant{above(32), 1}
+    );
+}
@@ -0,0 +1,153 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < threads; i++)
+        _queues.push_back(std::unique_ptr<Queue>(new Queue()));
+    // Queue 0 belongs to the thread calling 'parallel_for'
+    for (unsigned i = 1; i < threads; i++)
+        _workers.push_back(std::thread(&ThreadPool::_worker, this, i));
+}
+
+ThreadPool::~ThreadPool(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+    for (std::thread &worker: _workers) worker.join();
+}
+
+unsigned ThreadPool::size(void) const {return _queues.size();}
+
+void ThreadPool::parallel_for(
+    std::size_t count, std::size_t chunk,
+    const std::function<void(std::size_t, std::size_t)> &body
+)
+{
+    if (count == 0) return;
+    chunk = std::max<std::size_t>(chunk, 1);
+    const std::size_t chunks = (count + chunk - 1) / chunk;
+    if (_workers.empty() || chunks == 1)
+    {
+        for (std::size_t begin = 0; begin < count; begin += chunk)
+            body(begin, std::min(begin + chunk, count));
+        return;
+    }
+
+    std::lock_guard<std::mutex> call(_call_mutex);
+    // Published before any chunk is queued, taking a chunk locks its queue
+    _body = &body;
+    _error = nullptr;
+    _remaining = chunks;
+    const std::size_t n = _queues.size();
+    for (std::size_t c = 0; c < chunks; c++)
+    {
+        Queue &q = *_queues[c * n / chunks];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.ranges.push_back({c * chunk, std::min((c + 1) * chunk, count)});
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _generation++;
+    }
+    _wake.notify_all();
+
+    _work(0);
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _done.wait(lock, [this]() {return _remaining == 0;});
+    }
+    _body = nullptr;
+    if (_error) std::rethrow_exception(_error);
+}
+
+void ThreadPool::_worker(std::size_t index)
+{
+    std::size_t seen = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [&]() {return _stop || _generation != seen;});
+            if (_stop) return;
+            seen = _generation;
+        }
+        _work(index);
+    }
+}
+
+void ThreadPool::_work(std::size_t index)
+{
+    Range range;
+    while (_take(index, range))
+    {
+        try
+        {
+            (*_body)(range.begin, range.end);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_error) _error = std::current_exception();
+        }
+        if (_remaining.fetch_sub(1) == 1)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _done.notify_all();
+        }
+    }
+}
+
+bool ThreadPool::_take(std::size_t index, Range &range)
+{
+    const std::size_t n = _queues.size();
+    for (std::size_t k = 0; k < n; k++)
+    {
+        // Own queue from the front, the others from the back
+        Queue &q = *_queues[(index + k) % n];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.ranges.empty()) continue;
+        if (k == 0)
+        {
+            range = q.ranges.front();
+            q.ranges.pop_front();
+        }
+        else
+        {
+            range = q.ranges.back();
+            q.ranges.pop_back();
+        }
+        return true;
+    }
+    return false;
+}
+
+void parallel_membership(
+    ThreadPool &pool, const FuzzySet &set,
+    const double *input, std::size_t count, double *output, std::size_t chunk
+)
+{
+    pool.parallel_for(count, chunk, [&](std::size_t begin, std::size_t end)
+    {
+        set.membership(input + begin, output + begin, end - begin);
+    });
+}
+
+void parallel_membership(
+    ThreadPool &pool, const std::vector<FuzzySet> &sets,
+    const double *input, std::size_t count, double *output, std::size_t chunk
+)
+{
+    pool.parallel_for(count, chunk, [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t s = 0; s < sets.size(); s++)
+            sets[s].membership(
+                input + begin, output + s * count + begin, end - begin
+            );
+    });
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <exception>
+#include <condition_variable>
+#include <cstddef>
+
+#include "fuzzy.h"
+
+class ThreadPool
+{
+    /* Fixed group of threads running chunked loops. 'parallel_for' cuts the
+    range into chunks and deals them out in contiguous runs, one queue per
+    thread (the calling thread takes part as well). Threads take chunks from
+    the front of their own queue and, once it is empty, steal from the back
+    of the others, so threads that got cheap chunks (constant segments)
+    help out the ones stuck in expensive ones (exponentials, logarithms).
+    Calls are serialized, 'body' must not call 'parallel_for' itself. */
+    private:
+        typedef struct range
+        {
+            std::size_t begin, end;
+        } Range;
+        typedef struct queue
+        {
+            std::mutex mutex;
+            std::deque<Range> ranges;
+        } Queue;
+
+        std::vector<std::unique_ptr<Queue>> _queues;
+        std::vector<std::thread> _workers;
+        std::mutex _call_mutex;
+        std::mutex _mutex;
+        std::condition_variable _wake, _done;
+        std::size_t _generation = 0;
+        bool _stop = false;
+        const std::function<void(std::size_t, std::size_t)> *_body = nullptr;
+        std::atomic<std::size_t> _remaining{0};
+        std::exception_ptr _error;
+    public:
+        // 0 threads means one per hardware thread
+        ThreadPool(unsigned threads = 0);
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool &operator=(const ThreadPool&) = delete;
+        ~ThreadPool(void);
+        // Calls 'body(begin, end)' for chunks of [0, count), rethrows errors
+        void parallel_for(
+            std::size_t count, std::size_t chunk,
+            const std::function<void(std::size_t, std::size_t)> &body
+        );
+        unsigned size(void) const;
+    private:
+        void _worker(std::size_t index);
+        void _work(std::size_t index);
+        bool _take(std::size_t index, Range &range);
+};
+
+// Batch 'membership' of one set with chunks evaluated by the pool
+void parallel_membership(
+    ThreadPool &pool, const FuzzySet &set,
+    const double *input, std::size_t count, double *output,
+    std::size_t chunk = 16384
+);
+/* Memberships of 'count' inputs in every set, one column of 'count' values
+per set in 'output'. Each chunk of input is evaluated in all sets by one
+task while it is still in cache. */
+void parallel_membership(
+    ThreadPool &pool, const std::vector<FuzzySet> &sets,
+    const double *input, std::size_t count, double *output,
+    std::size_t chunk = 16384
+);
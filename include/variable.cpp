@@ -0,0 +1,132 @@
+#include "variable.h"
+#include "instrument.h"
+#include <stdexcept>
+#include <algorithm>
+#include <iterator>
+
+LinguisticVariable::LinguisticVariable(
+    const std::string name, const std::vector<FuzzySet> sets,
+    double lower, double upper
+): _name(name), _sets(sets), _lower(lower), _upper(upper)
+{
+    _index_sets();
+}
+
+void LinguisticVariable::_index_sets(void)
+{
+    _compiled.clear();
+    _breakpoints.clear();
+    for (const FuzzySet &set: _sets)
+    {
+        _compiled.push_back(CompiledFuzzySet(set));
+        const std::vector<double> &own = set.get_index().get_breakpoints();
+        std::vector<double> merged;
+        std::merge(_breakpoints.begin(), _breakpoints.end(),
+            own.begin(), own.end(), std::back_inserter(merged));
+        _breakpoints.swap(merged);
+    }
+    _breakpoints.erase(
+        std::unique(_breakpoints.begin(), _breakpoints.end()),
+        _breakpoints.end()
+    );
+
+    /* Every merged piece lies inside one piece of each set. A merged point
+    maps to the piece of that value, a merged interval to the piece right
+    after its lower breakpoint - the next piece when that breakpoint is one
+    of the set's own, the interval containing it otherwise. */
+    const std::size_t pieces = 2 * _breakpoints.size() + 1;
+    _owners.assign(pieces * _sets.size(), -1);
+    for (std::size_t p = 0; p < pieces; p++)
+        for (std::size_t s = 0; s < _sets.size(); s++)
+        {
+            const SegmentIndex &index = _compiled[s].get_index();
+            std::size_t own = 0;
+            if (p % 2) own = index.piece(_breakpoints[p / 2]);
+            else if (p > 0)
+            {
+                own = index.piece(_breakpoints[p / 2 - 1]);
+                if (own % 2) own++;
+            }
+            _owners[p * _sets.size() + s] = index.owner(own);
+        }
+
+    _tables.clear();
+    bool tabulated = false;
+    for (const FuzzySet &set: _sets) tabulated |= set.is_lut_enabled();
+    if (!tabulated) return;
+    _tables.assign(_owners.size(), nullptr);
+    for (std::size_t i = 0; i < _owners.size(); i++)
+        if (_owners[i] >= 0)
+            _tables[i] = _sets[i % _sets.size()].get_table(_owners[i]);
+}
+
+void LinguisticVariable::membership(double value, double *output) const
+{
+    const std::size_t count = _sets.size();
+    if (value != value)  // NaN is contained in no curve
+    {
+        std::fill(output, output + count, 0.0);
+        return;
+    }
+    std::size_t i = std::upper_bound(
+        _breakpoints.begin(), _breakpoints.end(), value
+    ) - _breakpoints.begin();
+    std::size_t piece = 2 * i;
+    if (i > 0 && _breakpoints[i - 1] == value) piece--;
+
+    const int *owners = _owners.data() + piece * count;
+    FUZZY_INSTRUMENT_ONLY(
+        for (std::size_t s = 0; s < count; s++)
+        {
+            count_membership(1, owners[s] < 0);
+            if (owners[s] >= 0)
+                count_evaluations(_sets[s].get_curves()[owners[s]], 1);
+        }
+    )
+    if (!_tables.empty())
+    {
+        const CurveTable *const *tables = _tables.data() + piece * count;
+        for (std::size_t s = 0; s < count; s++)
+            output[s] = owners[s] < 0 ? 0
+                : tables[s] ? tables[s]->membership(value)
+                : _compiled[s].segment_membership(owners[s], value);
+        return;
+    }
+    for (std::size_t s = 0; s < count; s++)
+        output[s] = owners[s] < 0 ? 0
+            : _compiled[s].segment_membership(owners[s], value);
+}
+
+std::vector<double> LinguisticVariable::membership(double value) const
+{
+    std::vector<double> output(_sets.size());
+    membership(value, output.data());
+    return output;
+}
+
+std::size_t LinguisticVariable::find(const std::string &set_name) const
+{
+    for (std::size_t i = 0; i < _sets.size(); i++)
+        if (_sets[i].get_name() == set_name) return i;
+    std::string message = "Variable '" + _name + "' has no set '"
+        + set_name + "'!";
+    throw std::out_of_range(message);
+}
+
+std::size_t LinguisticVariable::size(void) const {return _sets.size();}
+
+std::string LinguisticVariable::get_name(void) const {return _name;}
+
+const std::vector<FuzzySet> &LinguisticVariable::get_sets(void) const
+{
+    return _sets;
+}
+
+double LinguisticVariable::get_lower(void) const {return _lower;}
+
+double LinguisticVariable::get_upper(void) const {return _upper;}
+
+const std::vector<double> &LinguisticVariable::get_breakpoints(void) const
+{
+    return _breakpoints;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+#include "fuzzy.h"
+#include "compiled.h"
+
+class LinguisticVariable
+{
+    /* Named variable whose values are described by Fuzzy Sets (its terms),
+    e.g. 'temperature' with terms Freezing, Cold, Warm... The universe
+    bounds are needed when the variable is an output that gets
+    defuzzified.
+    Breakpoints of all sets are merged into one sorted table splitting the
+    universe into pieces the same way SegmentIndex does for one set. For
+    every piece the owning segment of each set is stored, so a single binary
+    search gives the whole membership vector. Sets in LUT mode are evaluated
+    through their tables, as FuzzySet::membership does. */
+    private:
+        std::string _name = "";
+        std::vector<FuzzySet> _sets;
+        double _lower = 0, _upper = 0;
+        std::vector<CompiledFuzzySet> _compiled;
+        std::vector<double> _breakpoints;
+        // Row of 'size()' segment indices (or -1) per piece
+        std::vector<int> _owners;
+        /* Table of each owner for sets in LUT mode, null for the others,
+        laid out as '_owners'. Empty when no set is in LUT mode. */
+        std::vector<const CurveTable*> _tables;
+    public:
+        LinguisticVariable(void) {};
+        LinguisticVariable(
+            const std::string name, const std::vector<FuzzySet> sets,
+            double lower = 0, double upper = 0
+        );
+        // Membership of 'value' in every set, 'output' holds 'size()' items
+        void membership(double value, double *output) const;
+        std::vector<double> membership(double value) const;
+        std::size_t find(const std::string &set_name) const;
+        std::size_t size(void) const;
+        std::string get_name(void) const;
+        const std::vector<FuzzySet> &get_sets(void) const;
+        double get_lower(void) const;
+        double get_upper(void) const;
+        const std::vector<double> &get_breakpoints(void) const;
+    private:
+        void _index_sets(void);
+};
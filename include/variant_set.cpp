@@ -0,0 +1,91 @@
+#include "variant_set.h"
+#include <algorithm>
+#include <variant>
+
+VariantFuzzySet::VariantFuzzySet(
+    const std::string name, const std::vector<CurveVariant> curves
+)
+{
+    _name = name; _curves = curves;
+    _index_curves();
+}
+
+VariantFuzzySet::VariantFuzzySet(const std::string name, const json &j_curves)
+{
+    _name = name;
+    _curves = curve_variants_from_json(j_curves);
+    _index_curves();
+}
+
+VariantFuzzySet::VariantFuzzySet(const json &j)
+{
+    _name = j.begin().key();
+    _curves = curve_variants_from_json(j.begin().value());
+    _index_curves();
+}
+
+VariantFuzzySet::VariantFuzzySet(const FuzzySet &set)
+{
+    _name = set.get_name();
+    for (const Curve *c: set.get_curves()) _curves.push_back(to_variant(c));
+    _index = set.get_index();
+}
+
+double VariantFuzzySet::membership(double value)
+{
+    int i = _index.find(value);
+    if (i < 0) return 0;
+    return std::visit(
+        [value](auto &curve) {return curve.membership(value);}, _curves[i]
+    );
+}
+
+void VariantFuzzySet::membership(
+    const double *input, double *output, std::size_t count
+)
+{
+    // Same blocking and run detection as the batch path of FuzzySet
+    const std::size_t block = 256;
+    int owners[block];
+
+    for (std::size_t start = 0; start < count; start += block)
+    {
+        const std::size_t n = std::min(block, count - start);
+        const double *in = input + start;
+        double *out = output + start;
+        for (std::size_t i = 0; i < n; i++) owners[i] = _index.find(in[i]);
+
+        std::size_t run = 0;
+        for (std::size_t i = 1; i <= n; i++)
+        {
+            if (i < n && owners[i] == owners[run]) continue;
+            if (owners[run] < 0) std::fill(out + run, out + i, 0.0);
+            else std::visit([&](auto &curve)
+                {
+                    curve.membership(in + run, out + run, i - run);
+                }, _curves[owners[run]]);
+            run = i;
+        }
+    }
+}
+
+std::string VariantFuzzySet::get_name(void) const {return _name;}
+
+const std::vector<CurveVariant> &VariantFuzzySet::get_curves(void) const
+{
+    return _curves;
+}
+
+json VariantFuzzySet::get_json(void)
+{
+    json j = json::array();
+    for (CurveVariant &c: _curves) j.push_back(get_curve(c)->get_json());
+    return json{{_name, j}};
+}
+
+void VariantFuzzySet::_index_curves(void)
+{
+    std::vector<const Curve*> curves;
+    for (CurveVariant &c: _curves) curves.push_back(get_curve(c));
+    _index = SegmentIndex(curves);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+#include "json.hpp"
+#include "curves.h"
+#include "fuzzy.h"
+#include "segment_index.h"
+
+using json = nlohmann::json;
+
+class VariantFuzzySet
+{
+    /* Fuzzy Set holding its curves by value as CurveVariant. Evaluation
+    dispatches with std::visit instead of virtual calls, copies are plain
+    value copies. Accepts the same JSON as FuzzySet. */
+    private:
+        std::string _name = "";
+        std::vector<CurveVariant> _curves;
+        SegmentIndex _index;
+    public:
+        VariantFuzzySet(void) {};
+        VariantFuzzySet(
+            const std::string name, const std::vector<CurveVariant> curves
+        );
+        VariantFuzzySet(const std::string name, const json &j_curves);
+        VariantFuzzySet(const json &j);
+        VariantFuzzySet(const FuzzySet &set);
+        double membership(double value);
+        void membership(
+            const double *input, double *output, std::size_t count
+        );
+        std::string get_name(void) const;
+        const std::vector<CurveVariant> &get_curves(void) const;
+        json get_json(void);
+    private:
+        void _index_curves(void);
+};
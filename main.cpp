@@ -1,14 +1,16 @@
 #include <iostream>
 #include <fstream>
 #include <cstdlib>
-#include "include\json.hpp"
-#include "include\fuzzy.h"
-#include "include\app.hpp"
+#include "include/json.hpp"
+#include "include/fuzzy.h"
+#include "include/app.hpp"
+#include "include/cli.h"
 
 using json = nlohmann::json;
 
 int main(int argc, char **argv)
 {
+    if (argc > 1) return run_command(argc, argv);
     App app;
     app.loop();
     return 0;
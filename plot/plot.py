@@ -1,26 +1,33 @@
 from cProfile import label
 from matplotlib import pyplot as plt
+import numpy as np
 import pandas as pd
 import sys
 import os
 
+def load(filename):
+    """Columns x and membership of a file written by 'generate_plot_data'.
+    '.npy' files are mapped as they are, CSV files are parsed."""
+    if filename.endswith(".npy"):
+        data = np.load(filename, mmap_mode="r")
+        return data[:, 0], data[:, 1]
+    data = pd.read_csv(filename, sep=";")
+    return data.iloc[:, 0], data.iloc[:, 1]
+
 def main(cmd_args):
     try:
         _, *filenames = cmd_args
     except ValueError as e:
-        raise ValueError("No '.csv' data files given for ploting!") from e
+        raise ValueError("No '.csv' or '.npy' data files given for ploting!") from e
     plt.figure("Fuzzy sets")
     plt.title("Membership functions of fuzzy sets")
     plt.xlabel("Input variable [...]")
     plt.ylabel("Membership function [-]")
     for filename in filenames:
         try:
-            data = pd.read_csv(filename, sep=";")
-            label = os.path.basename(filename).replace(".csv", "")
-            plt.plot(
-                data.iloc[:, 0], data.iloc[:, 1],
-                label=label
-            )
+            x, membership = load(filename)
+            label = os.path.splitext(os.path.basename(filename))[0]
+            plt.plot(x, membership, label=label)
         except FileNotFoundError as e:
             print(f"File '{filename}' not found! Skipping...")
     
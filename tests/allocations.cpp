@@ -0,0 +1,112 @@
+/* Allocation test, a separate executable because it replaces the global
+allocation functions of the whole program.
+Usage: allocation_tests
+Copies, moves and evaluates the shipped sets and returns 1 when any of that
+reaches the heap. Must be run from the repository root, next to the shipped
+'temperature_*.json' models. */
+
+#include <iostream>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <atomic>
+#include <new>
+#include "../include/fuzzy.h"
+#include "../include/variable.h"
+
+// Every heap allocation of the program goes through the operators below
+std::atomic<std::size_t> allocations(0);
+
+void *operator new(std::size_t size)
+{
+    allocations++;
+    if (void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {std::free(p);}
+void operator delete(void *p, std::size_t) noexcept {::operator delete(p);}
+
+// Sink for computed values, keeps the optimizer from dropping the work
+volatile double sink = 0;
+
+std::vector<double> uniform(double from, double to, std::size_t count)
+{
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> distribution(from, to);
+    std::vector<double> values(count);
+    for (double &x: values) x = distribution(generator);
+    return values;
+}
+
+/* Copying a set shares its curves and evaluating allocates nothing, so
+none of these may reach the heap once the outputs exist. Every operation
+runs once before it is counted, an instrumented build allocates the
+counters of a curve on its first evaluation in a thread. */
+int main(void)
+{
+    std::vector<std::string> filenames = {
+        "temperature_low.json", "temperature_high.json"
+    };
+    std::vector<FuzzySet> sets;
+    try
+    {
+        for (std::string filename: filenames)
+            for (FuzzySet &set: load_fuzzy_sets(filename))
+                sets.push_back(std::move(set));
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    LinguisticVariable variable("temperature", sets);
+    std::vector<double> probes = uniform(-30, 50, 1000);
+    std::vector<double> output(probes.size());
+    std::vector<double> memberships(sets.size());
+    FuzzySet copy;
+    std::map<std::string, std::function<void(void)>> operations = {
+        {"copy", [&]() {for (FuzzySet &set: sets) copy = FuzzySet(set);}},
+        {"move", [&]()
+            {
+                for (FuzzySet &set: sets)
+                {
+                    FuzzySet moved(std::move(set));
+                    set = std::move(moved);
+                }
+            }},
+        {"membership", [&]()
+            {
+                for (const FuzzySet &set: sets)
+                    for (double x: probes) sink = set.membership(x);
+            }},
+        {"batch", [&]()
+            {
+                for (const FuzzySet &set: sets)
+                    set.membership(probes.data(), output.data(), probes.size());
+            }},
+        {"variable", [&]()
+            {
+                for (double x: probes)
+                    variable.membership(x, memberships.data());
+            }}
+    };
+    for (auto &operation: operations)
+    {
+        operation.second();
+        const std::size_t before = allocations;
+        operation.second();
+        const std::size_t count = allocations - before;
+        if (count != 0)
+        {
+            std::cerr << "Operation '" << operation.first << "' allocated "
+                << count << " times!\n";
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,1852 @@
+/* Regression tests of the evaluation code.
+Usage: tests [name...]
+Runs the named tests (all of them when none is given), reports failures on
+stderr and returns 1 when any test fails. Must be run from the repository
+root, next to the shipped 'temperature_*.json' models, which is where CTest
+runs them. */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <utility>
+#include <functional>
+#include <atomic>
+#include <filesystem>
+#include <stdexcept>
+#include "../include/json.hpp"
+#include "../include/fuzzy.h"
+#include "../include/variable.h"
+#include "../include/compiled.h"
+#include "../include/binary_model.h"
+#include "../include/sax_loader.h"
+#include "../include/algebra.h"
+#include "../include/codegen.h"
+#include "../include/instrument.h"
+#include "../include/rules.h"
+#include "../include/mamdani.h"
+#include "../include/sugeno.h"
+#include "../include/render.h"
+#include "../include/mapped_file.h"
+#include "../include/plot_export.h"
+#include "../include/cli.h"
+#include "../include/thread_pool.h"
+#include "../include/temperature_sets.hpp"
+// Generated by codegen from the shipped models and edge cases at build time
+#include "temperature_low.hpp"
+#include "temperature_high.hpp"
+#include "codegen_cases.hpp"
+#include "temperature_low_fast.hpp"
+#include "temperature_high_fast.hpp"
+#include "codegen_cases_fast.hpp"
+
+using json = nlohmann::json;
+
+// Sink for computed values, keeps the optimizer from dropping the work
+volatile double sink = 0;
+
+std::vector<double> uniform(double from, double to, std::size_t count)
+{
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> distribution(from, to);
+    std::vector<double> values(count);
+    for (double &x: values) x = distribution(generator);
+    return values;
+}
+
+// Sets of both shipped models
+std::vector<FuzzySet> shipped_sets(void)
+{
+    std::vector<std::string> filenames = {
+        "temperature_low.json", "temperature_high.json"
+    };
+    std::vector<FuzzySet> sets;
+    for (std::string filename: filenames)
+        for (FuzzySet &set: load_fuzzy_sets(filename))
+            sets.push_back(std::move(set));
+    return sets;
+}
+
+// Compile-time sets must agree with the JSON files, bounds included
+bool test_static_sets(void)
+{
+    std::vector<FuzzySet> sets = shipped_sets();
+    using namespace temperature;
+    std::map<std::string, std::function<double(double)>> static_sets = {
+        {"Freezing", [](double x) {return Freezing.membership(x);}},
+        {"Cold", [](double x) {return Cold.membership(x);}},
+        {"Warm", [](double x) {return Warm.membership(x);}},
+        {"OK", [](double x) {return OK.membership(x);}},
+        {"Hot", [](double x) {return Hot.membership(x);}}
+    };
+    std::vector<double> probes = uniform(-30, 50, 1000);
+    for (double x: {-15.0, 0.0, 3.2824, 5.0, 10.0, 11.7176, 15.0, 20.0,
+        25.0, 30.0, 32.0}) probes.push_back(x);
+    for (FuzzySet &set: sets)
+        for (double x: probes)
+        {
+            double expected = set.membership(x);
+            double actual = static_sets.at(set.get_name())(x);
+            if (std::memcmp(&expected, &actual, sizeof(double)) != 0)
+            {
+                std::cerr << "Compile-time set '" << set.get_name()
+                    << "' differs at " << x << "!\n";
+                return false;
+            }
+        }
+    return true;
+}
+
+/* Largest difference of generated functions from FuzzySet at random points,
+at every breakpoint and its neighbours, at signed zeros, NaN and, unless
+'infinities' is false, the infinities. NaN when only one of the two is NaN,
+zero only when all values are the same doubles. */
+double generated_error(
+    const std::vector<FuzzySet> &sets,
+    const std::map<std::string, double (*)(double)> &functions,
+    bool infinities
+)
+{
+    const double infinity = std::numeric_limits<double>::infinity();
+    std::vector<double> probes = uniform(-30, 50, 1000);
+    probes.insert(probes.end(), {0.0, -0.0, std::nan(""), infinity, -infinity});
+    for (const FuzzySet &set: sets)
+        for (double x: set.get_index().get_breakpoints())
+            for (double p: {x, std::nextafter(x, -INFINITY),
+                std::nextafter(x, INFINITY)})
+                probes.push_back(p);
+    double error = 0;
+    for (const FuzzySet &set: sets)
+        for (double x: probes)
+        {
+            if (!infinities && std::isinf(x)) continue;
+            const double expected = set.membership(x);
+            const double actual = functions.at(set.get_name())(x);
+            if (std::memcmp(&expected, &actual, sizeof(double)) == 0)
+                continue;
+            if (std::isnan(expected) != std::isnan(actual)) return NAN;
+            // Differing signed zeros or NaN payloads count as well
+            const double difference = std::fabs(expected - actual);
+            error = std::max(error, difference > 0 ? difference
+                : std::numeric_limits<double>::denorm_min());
+        }
+    return error;
+}
+
+/* Functions generated from the shipped models and the edge cases must give
+the same doubles as FuzzySet, signed zeros included, the fast ones must
+stay within their documented error. Set names mapping to the same function
+name must be refused. */
+bool test_codegen(void)
+{
+    std::vector<FuzzySet> sets = shipped_sets();
+    const std::map<std::string, double (*)(double)> exact = {
+        {"Freezing", generated::membership_Freezing},
+        {"Cold", generated::membership_Cold},
+        {"Warm", generated::membership_Warm},
+        {"OK", generated::membership_OK},
+        {"Hot", generated::membership_Hot}
+    };
+    const std::map<std::string, double (*)(double)> fast = {
+        {"Freezing", generated_fast::membership_Freezing},
+        {"Cold", generated_fast::membership_Cold},
+        {"Warm", generated_fast::membership_Warm},
+        {"OK", generated_fast::membership_OK},
+        {"Hot", generated_fast::membership_Hot}
+    };
+    std::vector<FuzzySet> cases = load_fuzzy_sets("tests/codegen_cases.json");
+    const std::map<std::string, double (*)(double)> exact_cases = {
+        {"Signed zero", generated::membership_Signed_zero},
+        {"Flat top", generated::membership_Flat_top},
+        {"Everywhere", generated::membership_Everywhere},
+        {"Open parabola", generated::membership_Open_parabola}
+    };
+    const std::map<std::string, double (*)(double)> fast_cases = {
+        {"Signed zero", generated_fast::membership_Signed_zero},
+        {"Flat top", generated_fast::membership_Flat_top},
+        {"Everywhere", generated_fast::membership_Everywhere},
+        {"Open parabola", generated_fast::membership_Open_parabola}
+    };
+    const double errors[] = {
+        generated_error(sets, exact, true),
+        generated_error(cases, exact_cases, true),
+        generated_error(sets, fast, false),
+        generated_error(cases, fast_cases, false)
+    };
+    if (errors[0] != 0 || errors[1] != 0)
+    {
+        std::cerr << "Generated sets differ from FuzzySet by " << errors[0]
+            << " and " << errors[1] << "!\n";
+        return false;
+    }
+    if (!(errors[2] <= 1e-12) || !(errors[3] <= 1e-12))
+    {
+        std::cerr << "Fast generated sets differ from FuzzySet by "
+            << errors[2] << " and " << errors[3] << "!\n";
+        return false;
+    }
+
+    const json curves = json::parse(R"([{"ConstantCurve": {"value": 1}}])");
+    const std::vector<std::vector<std::string>> clashes = {
+        {"A-B", "A_B"}, {"\xc3\x84", "\xc3\x96"}, {"Cold", "Cold"}
+    };
+    for (const std::vector<std::string> &names: clashes)
+    {
+        std::vector<FuzzySet> clashing;
+        for (const std::string &name: names)
+            clashing.emplace_back(name, curves);
+        try
+        {
+            generate_header(clashing);
+        }
+        catch (const std::invalid_argument &)
+        {
+            continue;
+        }
+        std::cerr << "Sets '" << names[0] << "' and '" << names[1]
+            << "' generated clashing functions!\n";
+        return false;
+    }
+    return true;
+}
+
+// Whole file as bytes, and a file of the given bytes
+std::string read_bytes(const std::string &filename)
+{
+    std::ifstream input_file(filename, std::ios::binary);
+    std::ostringstream buffer;
+    buffer << input_file.rdbuf();
+    return buffer.str();
+}
+
+void write_bytes(const std::string &filename, const std::string &bytes)
+{
+    std::ofstream output_file(filename, std::ios::binary | std::ios::trunc);
+    output_file.write(bytes.data(), bytes.size());
+}
+
+// File of the tests in the temporary directory
+std::string temporary(const std::string &name)
+{
+    return (std::filesystem::temp_directory_path()
+        / ("fuzzy_tests_" + name)).string();
+}
+
+// Exit code of a 'fuzzy' command line, run as main runs it
+int run(std::vector<std::string> arguments)
+{
+    arguments.insert(arguments.begin(), "fuzzy");
+    std::vector<char*> argv;
+    for (std::string &argument: arguments) argv.push_back(&argument[0]);
+    return run_command(int(argv.size()), argv.data());
+}
+
+// What a 'fuzzy' command line reports on stderr, empty when it succeeds
+std::string failure(const std::vector<std::string> &arguments)
+{
+    std::ostringstream errors;
+    std::streambuf *previous = std::cerr.rdbuf(errors.rdbuf());
+    const int code = run(arguments);
+    std::cerr.rdbuf(previous);
+    if (code == 0) return "";
+    return errors.str().empty() ? "exit code " + std::to_string(code)
+        : errors.str();
+}
+
+// True when opening the file as a '.fzb' model is refused
+bool rejected(const std::string &filename)
+{
+    try
+    {
+        BinaryModel model(filename);
+    }
+    catch (const std::invalid_argument &)
+    {
+        return true;
+    }
+    return false;
+}
+
+/* JSON -> .fzb -> JSON keeps every set as it was and .fzb -> JSON -> .fzb
+gives the same bytes, for the shipped models and a scaled exponential.
+Sets evaluated in place by BinaryModel agree with FuzzySet, damaged files
+are refused. */
+bool test_binary_model(void)
+{
+    std::vector<FuzzySet> sets = shipped_sets();
+    sets.emplace_back("Scaled", json::parse(R"([
+        {"ConstantCurve": {"bounds": {"upper": 0}, "value": 0.25}},
+        {"ExponentialCurve": {
+            "bounds": {"lower": 0, "lower_inclusive": true, "upper": 4},
+            "base": 1.5, "x_offset": 1, "y_offset": -0.125, "scale": 0.3
+        }}
+    ])"));
+    const std::filesystem::path directory =
+        std::filesystem::temp_directory_path();
+    const std::string first = (directory / "fuzzy_tests_1.fzb").string();
+    const std::string second = (directory / "fuzzy_tests_2.fzb").string();
+    const std::string damaged = (directory / "fuzzy_tests_3.fzb").string();
+    bool passed = true;
+    auto fail = [&passed](const std::string &message)
+    {
+        std::cerr << message << "\n";
+        passed = false;
+    };
+
+    save_binary_model(sets, first);
+    std::vector<FuzzySet> loaded = load_binary_model(first);
+    if (loaded.size() != sets.size()) fail("Binary model lost sets!");
+    for (std::size_t s = 0; s < sets.size() && s < loaded.size(); s++)
+        if (loaded[s].get_json() != sets[s].get_json())
+            fail("Set '" + sets[s].get_name() + "' changed in .fzb!");
+
+    json j = json::array();
+    for (const FuzzySet &set: loaded) j.push_back(set.get_json());
+    std::istringstream text(j.dump(4));
+    save_binary_model(parse_fuzzy_sets(text), second);
+    if (read_bytes(first) != read_bytes(second))
+        fail("Model converted to JSON and back differs from the .fzb!");
+
+    BinaryModel model(first);
+    std::vector<double> probes = uniform(-30, 50, 1000);
+    for (const FuzzySet &set: sets)
+        for (double x: set.get_index().get_breakpoints())
+            probes.push_back(x);
+    std::vector<double> output(probes.size());
+    for (std::size_t s = 0; s < sets.size(); s++)
+    {
+        model.membership(s, probes.data(), output.data(), probes.size());
+        for (std::size_t i = 0; i < probes.size(); i++)
+        {
+            const double expected = sets[s].membership(probes[i]);
+            const double actual = model.membership(s, probes[i]);
+            if (std::memcmp(&expected, &actual, sizeof(double))
+                || std::memcmp(&expected, &output[i], sizeof(double)))
+            {
+                fail("Binary set '" + sets[s].get_name() + "' differs at "
+                    + std::to_string(probes[i]) + "!");
+                break;
+            }
+        }
+    }
+
+    const std::string bytes = read_bytes(first);
+    FzbHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    for (std::size_t size: {std::size_t(0), sizeof(FzbHeader) - 1,
+        std::size_t(header.names), bytes.size() - 1})
+    {
+        write_bytes(damaged, bytes.substr(0, size));
+        if (!rejected(damaged))
+            fail("File cut to " + std::to_string(size) + " bytes accepted!");
+    }
+    // Byte offset and the value written over it
+    const FzbSet &last = reinterpret_cast<const FzbSet*>(
+        bytes.data() + header.sets)[header.set_count - 1];
+    const std::vector<std::pair<std::size_t, std::string>> damages = {
+        {0, "X"},
+        {offsetof(FzbHeader, version), std::string(1, char(fzb_version + 1))},
+        {offsetof(FzbHeader, owners), std::string(1, char(header.owners + 4))},
+        {header.types, std::string(1, char(100))},
+        {header.owners + 4 * last.first_owner, std::string(4, char(0x7f))},
+        {header.sets + (header.set_count - 1) * sizeof(FzbSet)
+            + offsetof(FzbSet, segment_count), std::string(1, char(100))}
+    };
+    for (auto &damage: damages)
+    {
+        std::string copy = bytes;
+        copy.replace(damage.first, damage.second.size(), damage.second);
+        write_bytes(damaged, copy);
+        if (!rejected(damaged))
+            fail("File damaged at byte " + std::to_string(damage.first)
+                + " accepted!");
+    }
+
+    for (std::string filename: {first, second, damaged})
+        std::remove(filename.c_str());
+    return passed;
+}
+
+/* Eval and batch of a '.fzb' model, evaluated in place, must write the
+same bytes as for the JSON model it was converted from. */
+bool test_binary_commands(void)
+{
+    const std::string model = temporary("low.fzb");
+    const std::string text = temporary("values.txt");
+    const std::string values = temporary("values.bin");
+    const std::string outputs[] = {
+        temporary("json.csv"), temporary("fzb.csv"),
+        temporary("json.bin"), temporary("fzb.bin")
+    };
+    std::vector<double> probes = uniform(-30, 50, 1000);
+    probes.insert(probes.end(), {-15, 0, 3.2824, 10, 11.7176, 15, 20, 30});
+    std::ostringstream numbers;
+    for (double x: probes) numbers << x << "\n";
+    write_bytes(text, numbers.str());
+    write_bytes(values, std::string(
+        reinterpret_cast<const char*>(probes.data()),
+        probes.size() * sizeof(double)
+    ));
+
+    bool passed = run({"convert", "temperature_low.json", model}) == 0;
+    const std::string models[] = {"temperature_low.json", model};
+    for (int i = 0; i < 2; i++)
+    {
+        passed &= run({"eval", "--model", models[i], "--model",
+            "temperature_high.json", "--input", text,
+            "--output", outputs[i]}) == 0;
+        passed &= run({"batch", "--model", models[i], "--model",
+            "temperature_high.json", "--input", values,
+            "--output", outputs[2 + i], "--chunk", "100"}) == 0;
+    }
+    if (!passed) std::cerr << "Commands on the .fzb model failed!\n";
+    else if (read_bytes(outputs[0]) != read_bytes(outputs[1])
+        || read_bytes(outputs[2]) != read_bytes(outputs[3]))
+    {
+        std::cerr << "Commands on the .fzb model differ from JSON!\n";
+        passed = false;
+    }
+    for (const std::string &filename: {model, text, values, outputs[0],
+        outputs[1], outputs[2], outputs[3]})
+        std::remove(filename.c_str());
+    return passed;
+}
+
+/* Set built by an operation against the pointwise 'expected' value, at
+probes spread over the real line, on and around every breakpoint. Cut
+points of crossings may be off by a rounding error, which moves the value
+by about as much. */
+bool matches(
+    const FuzzySet &set, const std::function<double(double)> &expected,
+    std::vector<double> probes
+)
+{
+    for (double x: set.get_index().get_breakpoints())
+        if (std::isfinite(x))
+            for (double p: {x, std::nextafter(x, -INFINITY),
+                std::nextafter(x, INFINITY), x - 1e-6, x + 1e-6})
+                probes.push_back(p);
+    for (double x: probes)
+    {
+        const double actual = set.membership(x), wanted = expected(x);
+        if (actual != wanted
+            && !(fabs(actual - wanted) <= 1e-9 * std::max(1.0, fabs(wanted))))
+        {
+            std::cerr << "Set '" << set.get_name() << "' gives " << actual
+                << " instead of " << wanted << " at " << x << "!\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Union, intersection and complement must give max, min and 1 - x of the
+operands everywhere. Pairs cover the shipped sets and every kind of curve
+against each other, including crossings far out on an unbounded curve and
+two crossings close together. */
+bool test_algebra(void)
+{
+    std::vector<FuzzySet> sets = shipped_sets();
+    const std::vector<std::string> curves = {
+        R"({"ExponentialCurve": {"base": 1.001, "x_offset": 0,
+            "y_offset": 0}})",
+        R"({"ConstantCurve": {"value": 0.5}})",
+        R"({"QuadraticCurve": {"bounds": {"lower": 0, "upper": 100},
+            "a": 1, "b": -50.4, "c": 636.03}})",
+        R"({"ExponentialCurve": {"bounds": {"lower": 0, "upper": 100},
+            "base": 1.0000001, "x_offset": 0, "y_offset": 0}})",
+        R"({"ExponentialCurve": {"base": 2, "x_offset": 0,
+            "y_offset": 0, "scale": 0.1}})",
+        R"({"ExponentialCurve": {"base": 0.5, "x_offset": 1,
+            "y_offset": 0.2}})",
+        R"({"LogarithmicCurve": {"bounds": {"lower": 0}, "base": 2.718281828,
+            "x_offset": 0, "y_offset": 0}})",
+        R"({"LogarithmicCurve": {"bounds": {"lower": 0}, "base": 10,
+            "x_offset": -1, "y_offset": 0.5}})",
+        R"({"ExponentialCurve": {"bounds": {"lower": 0, "upper": 20},
+            "base": 1.5, "x_offset": 2, "y_offset": -1}})",
+        R"({"QuadraticCurve": {"bounds": {"lower": 0, "upper": 20},
+            "a": -0.01, "b": 0.1, "c": 0.75}})",
+        R"({"LinearCurve": {"bounds": {"lower": -5, "upper": 5},
+            "slope": 0.1, "intercept": 0.5}})"
+    };
+    for (std::size_t i = 0; i < curves.size(); i++)
+        sets.emplace_back(
+            "curve " + std::to_string(i), json::array({json::parse(curves[i])})
+        );
+
+    std::vector<double> probes = uniform(-3000, 3000, 500);
+    for (double x: uniform(-50, 120, 2000)) probes.push_back(x);
+    for (double x: uniform(24, 27, 500)) probes.push_back(x);
+    for (double x: {-1000.0, -693.5, 0.0, 25.2, 100.0}) probes.push_back(x);
+    for (const FuzzySet &a: sets)
+    {
+        auto complement = [&a](double x) {return 1 - a.membership(x);};
+        if (!matches(fuzzy_complement(a), complement, probes)) return false;
+        for (const FuzzySet &b: sets)
+        {
+            auto maximum = [&a, &b](double x)
+            {
+                return std::max(a.membership(x), b.membership(x));
+            };
+            auto minimum = [&a, &b](double x)
+            {
+                return std::min(a.membership(x), b.membership(x));
+            };
+            if (!matches(fuzzy_union(a, b), maximum, probes)
+                || !matches(fuzzy_intersection(a, b), minimum, probes))
+                return false;
+        }
+    }
+    return true;
+}
+
+/* Optional parameters take their defaults in the streaming loader as in
+the curve constructors, missing required ones are refused. */
+bool test_optional_parameters(void)
+{
+    const std::string text = R"([{"Growth": [
+        {"ExponentialCurve": {"bounds": {"upper": 0},
+            "base": 2, "x_offset": 1, "y_offset": 0.1}},
+        {"ExponentialCurve": {"bounds": {"lower": 0},
+            "base": 0.5, "x_offset": 0, "y_offset": 0, "scale": 0.4}}
+    ]}])";
+    std::istringstream input(text);
+    std::vector<FuzzySet> streamed = parse_fuzzy_sets(input);
+    FuzzySet built(json::parse(text)[0]);
+    for (double x: uniform(-10, 10, 1000))
+        if (streamed[0].membership(x) != built.membership(x))
+        {
+            std::cerr << "Streamed set differs at " << x << "!\n";
+            return false;
+        }
+    std::istringstream incomplete(
+        R"([{"Growth": [{"ExponentialCurve": {"base": 2, "scale": 2}}]}])"
+    );
+    try
+    {
+        parse_fuzzy_sets(incomplete);
+    }
+    catch (const std::invalid_argument &)
+    {
+        return true;
+    }
+    std::cerr << "Curve without required parameters accepted!\n";
+    return false;
+}
+
+/* Simpson's rule for x^k * membership over each piece between neighbouring
+'points', ends taken just inside so each piece sees only its own curve */
+double numeric_moment(
+    const FuzzySet &set, const std::vector<double> &points, int k
+)
+{
+    const int cells = 20000;
+    double sum = 0;
+    for (std::size_t p = 0; p + 1 < points.size(); p++)
+    {
+        const double from = points[p], to = points[p + 1];
+        const double h = (to - from) / cells;
+        auto f = [&](int i)
+        {
+            double x = from + i * h;
+            if (i == 0) x = std::nextafter(from, to);
+            if (i == cells) x = std::nextafter(to, from);
+            return pow(x, k) * set.membership(x);
+        };
+        double piece = f(0) + f(cells);
+        for (int i = 1; i < cells; i++) piece += (i % 2 ? 4 : 2) * f(i);
+        sum += piece * h / 3;
+    }
+    return sum;
+}
+
+/* Moments, area and centroid against numeric integration for every kind
+of curve, one set with several curves and one with an unbounded decaying
+exponential. Centroids of sets with infinite or zero area are refused. */
+bool test_moments(void)
+{
+    typedef struct moment_case
+    {
+        std::string curves;
+        std::vector<double> points;
+    } MomentCase;
+    const std::vector<MomentCase> cases = {
+        {R"([{"ConstantCurve": {"bounds": {"lower": -2, "upper": 3},
+            "value": 0.7}}])", {-2, 3}},
+        {R"([{"LinearCurve": {"bounds": {"lower": 0, "upper": 5},
+            "slope": 0.1, "intercept": 0.3}}])", {0, 5}},
+        {R"([{"QuadraticCurve": {"bounds": {"lower": 0, "upper": 10},
+            "a": -0.04, "b": 0.4, "c": 0}}])", {0, 10}},
+        {R"([{"ExponentialCurve": {"bounds": {"lower": 0, "upper": 4},
+            "base": 1.5, "x_offset": 2, "y_offset": -0.1, "scale": 0.3}}])",
+            {0, 4}},
+        {R"([{"LogarithmicCurve": {"bounds": {"lower": 0, "upper": 6},
+            "base": 10, "x_offset": -1, "y_offset": 0.2}}])", {0, 6}},
+        {R"([{"ExponentialCurve": {"bounds": {"lower": 0},
+            "base": 0.5, "x_offset": 0, "y_offset": 0}}])", {0, 80}},
+        {R"([
+            {"LinearCurve": {"bounds": {"lower": -4, "upper": 0},
+                "slope": 0.25, "intercept": 1}},
+            {"ConstantCurve": {"bounds": {"lower": 0, "upper": 2,
+                "lower_inclusive": true}, "value": 1}},
+            {"QuadraticCurve": {"bounds": {"lower": 2, "upper": 5},
+                "a": -0.1, "b": 0.2, "c": 1}}
+        ])", {-4, 0, 2, 5}}
+    };
+    for (const MomentCase &c: cases)
+    {
+        const FuzzySet set("case", json::parse(c.curves));
+        for (int k = 0; k <= 4; k++)
+        {
+            const double exact = set.moment(k);
+            const double numeric = numeric_moment(set, c.points, k);
+            if (!(fabs(exact - numeric) <= 1e-7 * std::max(1.0, fabs(numeric))))
+            {
+                std::cerr << "Moment " << k << " of " << c.curves << " is "
+                    << exact << " instead of " << numeric << "!\n";
+                return false;
+            }
+        }
+        const double centroid = numeric_moment(set, c.points, 1)
+            / numeric_moment(set, c.points, 0);
+        if (set.area() != set.moment(0)
+            || !(fabs(set.centroid() - centroid) <= 1e-7))
+        {
+            std::cerr << "Centroid of " << c.curves << " is "
+                << set.centroid() << " instead of " << centroid << "!\n";
+            return false;
+        }
+    }
+
+    const std::vector<FuzzySet> undefined = {
+        FuzzySet("infinite", json::parse(
+            R"([{"ConstantCurve": {"bounds": {"upper": 0}, "value": 1}}])"
+        )),
+        FuzzySet()
+    };
+    for (const FuzzySet &set: undefined)
+    {
+        try
+        {
+            set.centroid();
+        }
+        catch (const std::domain_error &)
+        {
+            continue;
+        }
+        std::cerr << "Centroid of '" << set.get_name() << "' accepted!\n";
+        return false;
+    }
+    return std::isinf(undefined[0].area());
+}
+
+/* Batch membership must give the same doubles as the scalar one, at
+inclusive and exclusive bounds, between curves, at signed zeros, NaN and the
+infinities, for sorted inputs (long runs of one curve) and shuffled ones. */
+// Shipped sets, codegen cases and a set with gaps between its curves
+std::vector<FuzzySet> probe_sets(void)
+{
+    std::vector<FuzzySet> sets = shipped_sets();
+    for (FuzzySet &set: load_fuzzy_sets("tests/codegen_cases.json"))
+        sets.push_back(std::move(set));
+    sets.emplace_back("Gaps", json::parse(R"([
+        {"ConstantCurve": {"bounds": {"lower": 0, "upper": 1},
+            "value": 0.5}},
+        {"LinearCurve": {"bounds": {"lower": 2, "upper": 3,
+            "lower_inclusive": true, "upper_inclusive": true},
+            "slope": 0.5, "intercept": -0.5}},
+        {"QuadraticCurve": {"bounds": {"lower": 3, "upper": 4,
+            "upper_inclusive": true}, "a": -1, "b": 7, "c": -11}}
+    ])"));
+    return sets;
+}
+
+// Random values, signed zeros, NaN, infinities and values at every breakpoint
+std::vector<double> membership_probes(const std::vector<FuzzySet> &sets)
+{
+    const double infinity = std::numeric_limits<double>::infinity();
+    std::vector<double> probes = uniform(-30, 50, 2000);
+    std::sort(probes.begin(), probes.begin() + 1000);
+    probes.insert(probes.end(), {0.0, -0.0, std::nan(""), infinity,
+        -infinity, 1.5, 5.0});
+    for (const FuzzySet &set: sets)
+        for (double x: set.get_index().get_breakpoints())
+            probes.insert(probes.end(), {x, std::nextafter(x, -infinity),
+                std::nextafter(x, infinity)});
+    return probes;
+}
+
+bool test_batch(void)
+{
+    std::vector<FuzzySet> sets = probe_sets();
+    std::vector<double> probes = membership_probes(sets);
+    std::vector<double> output(probes.size());
+    for (const FuzzySet &set: sets)
+    {
+        set.membership(probes.data(), output.data(), probes.size());
+        for (std::size_t i = 0; i < probes.size(); i++)
+        {
+            const double expected = set.membership(probes[i]);
+            if (std::memcmp(&expected, &output[i], sizeof(double)))
+            {
+                std::cerr << "Batch membership of '" << set.get_name()
+                    << "' differs at " << probes[i] << "!\n";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// The compiled form must give bit for bit what the set gives
+bool test_compiled(void)
+{
+    std::vector<FuzzySet> sets = probe_sets();
+    std::vector<double> probes = membership_probes(sets);
+    std::vector<double> output(probes.size());
+    for (const FuzzySet &set: sets)
+    {
+        CompiledFuzzySet compiled(set);
+        if (compiled.size() != set.get_curves().size()
+            || compiled.get_name() != set.get_name())
+        {
+            std::cerr << "Compiled '" << set.get_name()
+                << "' has the wrong size or name!\n";
+            return false;
+        }
+        compiled.membership(probes.data(), output.data(), probes.size());
+        for (std::size_t i = 0; i < probes.size(); i++)
+        {
+            const double expected = set.membership(probes[i]);
+            const double scalar = compiled.membership(probes[i]);
+            if (std::memcmp(&expected, &scalar, sizeof(double))
+                || std::memcmp(&expected, &output[i], sizeof(double)))
+            {
+                std::cerr << "Compiled membership of '" << set.get_name()
+                    << "' differs at " << probes[i] << "!\n";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/* The index must pick the curve a scan in curve order would pick - the
+first one containing the value - for overlapping and nested curves, curves
+of a single point and every mix of inclusive and exclusive bounds, at the
+bounds, next to them, between them, at the infinities and NaN. */
+bool test_segment_index(void)
+{
+    const double infinity = std::numeric_limits<double>::infinity();
+    const double bounds[] = {-infinity, -2, -1, 0, 0.5, 1, 2, infinity};
+    std::mt19937 generator(7);
+    std::uniform_int_distribution<int> bound(0, 7), flag(0, 1), size(1, 6);
+    std::vector<double> probes = {std::nan(""), 0.25, 1.5, 3, -3};
+    for (double x: bounds)
+        probes.insert(probes.end(), {x, std::nextafter(x, -infinity),
+            std::nextafter(x, infinity)});
+    for (int trial = 0; trial < 2000; trial++)
+    {
+        std::vector<ConstantCurve> storage;
+        const int count = size(generator);
+        for (int c = 0; c < count; c++)
+        {
+            double lower = bounds[bound(generator)];
+            double upper = bounds[bound(generator)];
+            if (lower > upper) std::swap(lower, upper);
+            const bool lower_inclusive = flag(generator);
+            storage.emplace_back(lower, upper, c, lower_inclusive,
+                flag(generator));
+        }
+        std::vector<const Curve*> curves;
+        for (const ConstantCurve &c: storage) curves.push_back(&c);
+        SegmentIndex index(curves);
+        for (double x: probes)
+        {
+            int expected = -1;
+            for (std::size_t c = 0; c < curves.size() && expected < 0; c++)
+                if (curves[c]->contains(x)) expected = c;
+            if (index.find(x) != expected)
+            {
+                std::cerr << "Index found curve " << index.find(x)
+                    << " instead of " << expected << " at " << x
+                    << " in trial " << trial << "!\n";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// The merged index of a variable must give what its sets give one by one
+bool test_variable(void)
+{
+    std::vector<FuzzySet> sets = shipped_sets();
+    LinguisticVariable variable("temperature", sets);
+    std::vector<double> probes = uniform(-30, 50, 1000);
+    for (double x: variable.get_breakpoints()) probes.push_back(x);
+    std::vector<double> memberships(sets.size());
+    for (double x: probes)
+    {
+        variable.membership(x, memberships.data());
+        for (std::size_t i = 0; i < sets.size(); i++)
+        {
+            double expected = sets[i].membership(x);
+            if (std::memcmp(&expected, &memberships[i], sizeof(double)))
+            {
+                std::cerr << "Variable differs from set '"
+                    << sets[i].get_name() << "' at " << x << "!\n";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/* LUT mode must stay within the requested error, h^2 / 8 * max|y''| with
+the cell width it chose, and report the tables it built. Only the bounded
+exponential and logarithmic curves get a table, the rest stays exact, and
+a variable of sets in LUT mode must give what the sets give. */
+bool test_lut(void)
+{
+    std::vector<FuzzySet> sets = shipped_sets();
+    std::vector<double> probes = uniform(-30, 50, 20000);
+    for (const FuzzySet &set: sets)
+        for (double x: set.get_index().get_breakpoints())
+            probes.push_back(x);
+    for (double max_error: {1e-2, 1e-4, 1e-6})
+    {
+        std::vector<FuzzySet> tabulated = sets;
+        for (FuzzySet &set: tabulated) set.enable_lut(max_error);
+        for (std::size_t s = 0; s < sets.size(); s++)
+        {
+            const FuzzySet &set = tabulated[s];
+            const std::vector<const Curve*> &curves = set.get_curves();
+            std::size_t tables = 0, bytes = 0;
+            for (std::size_t c = 0; c < curves.size(); c++)
+            {
+                const Curve *curve = curves[c];
+                const CurveType type = curve->get_type();
+                const bool tabulable = curve->is_finite()
+                    && (type == CurveType::Exponential
+                    || type == CurveType::Logarithmic);
+                if (tabulable != (set.get_table(c) != nullptr))
+                {
+                    std::cerr << "Curve " << c << " of '" << set.get_name()
+                        << "' has the wrong kind of evaluation!\n";
+                    return false;
+                }
+                if (!tabulable) continue;
+                const double from = curve->get_lower_bound();
+                const double to = curve->get_upper_bound();
+                const double cells = std::max(1.0, std::ceil((to - from)
+                    * std::sqrt(curve->curvature_bound(from, to)
+                    / (8 * max_error))));
+                tables++;
+                bytes += (std::size_t(cells) + 1) * sizeof(double);
+            }
+            const LutStatistics statistics = set.get_lut_statistics();
+            if (statistics.tables != tables || statistics.bytes != bytes
+                || !(statistics.error <= statistics.error_bound)
+                || !(statistics.error_bound <= max_error))
+            {
+                std::cerr << "LUT statistics of '" << set.get_name()
+                    << "' are wrong for error " << max_error << "!\n";
+                return false;
+            }
+            // Rounding of the interpolation adds a few ulps to the bound
+            for (double x: probes)
+            {
+                const double exact = sets[s].membership(x);
+                const double error = std::fabs(set.membership(x) - exact);
+                if (!(error <= max_error + 1e-15)
+                    || (tables == 0 && error != 0))
+                {
+                    std::cerr << "LUT of '" << set.get_name() << "' is off by "
+                        << error << " at " << x << " for error " << max_error
+                        << "!\n";
+                    return false;
+                }
+            }
+        }
+
+        LinguisticVariable variable("temperature", tabulated);
+        std::vector<double> memberships(tabulated.size());
+        for (double x: probes)
+        {
+            variable.membership(x, memberships.data());
+            for (std::size_t s = 0; s < tabulated.size(); s++)
+            {
+                const double expected = tabulated[s].membership(x);
+                if (std::memcmp(&expected, &memberships[s], sizeof(double)))
+                {
+                    std::cerr << "Variable differs from LUT set '"
+                        << tabulated[s].get_name() << "' at " << x << "!\n";
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/* Counters of an instrumented build must grow by exactly what is evaluated,
+sets of the shipped models cover [-inf, inf] so nothing falls outside.
+Passes trivially when the instrumentation is compiled out. */
+/* Plot files exported by the pool must hold what 'generate_plot_data'
+writes for each set alone, with sets of the same name (also differing only
+in case) in files of their own. The combined file must be the same from
+any number of threads, its sets in order across the groups formatted at
+once, names with separators quoted. */
+bool test_plot_export(void)
+{
+    std::vector<FuzzySet> sets;
+    for (int copy = 0; copy < 110; copy++)
+        for (const FuzzySet &set: shipped_sets())
+        {
+            std::string name = set.get_name();
+            if (copy % 3 == 1) name += std::to_string(copy);
+            if (copy % 3 == 2) name = "LOW";
+            if (copy == 5) name = "semi;colon \"quoted\"";
+            sets.push_back(FuzzySet(name, set.get_json().begin().value()));
+        }
+    const std::string directory = temporary("export");
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directory(directory);
+    const std::string reference = temporary("export_reference");
+    ThreadPool pool(4), single(1);
+    for (std::string extension: {".csv", ".npy"})
+    {
+        std::vector<std::string> files =
+            export_plot_data(pool, sets, directory + "/", extension);
+        std::set<std::string> unique;
+        for (const std::string &file: files)
+        {
+            std::string key = file;
+            for (char &c: key) c = std::tolower(static_cast<unsigned char>(c));
+            unique.insert(key);
+        }
+        if (files.size() != sets.size() || unique.size() != sets.size())
+        {
+            std::cerr << "Export gave " << unique.size()
+                << " distinct files for " << sets.size() << " sets!\n";
+            return false;
+        }
+        for (std::size_t i = 0; i < sets.size(); i++)
+        {
+            sets[i].generate_plot_data(reference + extension);
+            if (read_bytes(files[i]) != read_bytes(reference + extension))
+            {
+                std::cerr << "Exported " << files[i] << " differs!\n";
+                return false;
+            }
+        }
+    }
+
+    const std::string parallel = temporary("export_parallel.csv");
+    const std::string serial = temporary("export_serial.csv");
+    export_combined_plot_data(pool, sets, parallel);
+    export_combined_plot_data(single, sets, serial);
+    const std::string combined = read_bytes(parallel);
+    std::istringstream rows(combined);
+    std::string row;
+    std::getline(rows, row);
+    bool ordered = row == "set;x;membership";
+    for (const FuzzySet &set: sets)
+    {
+        std::vector<double> x, y;
+        set.sample(x, y);
+        for (std::size_t i = 0; ordered && i < x.size(); i++)
+        {
+            std::getline(rows, row);
+            const std::size_t end = row.rfind(';', row.rfind(';') - 1);
+            std::string name = row.substr(0, end);
+            if (name.size() > 1 && name.front() == '"')
+            {
+                std::string unquoted;
+                for (std::size_t c = 1; c + 1 < name.size(); c++)
+                    if (name[c] != '"' || name[++c] == '"')
+                        unquoted += name[c];
+                name = unquoted;
+            }
+            ordered = name == set.get_name()
+                && std::strtod(row.c_str() + end + 1, nullptr) == x[i];
+        }
+    }
+    ordered &= !std::getline(rows, row);
+    if (combined != read_bytes(serial) || !ordered)
+    {
+        std::cerr << "Combined export differs at row: " << row << "\n";
+        return false;
+    }
+    std::filesystem::remove_all(directory);
+    return true;
+}
+
+/* Windows of a MappedFile may start anywhere, also across page bounds,
+and what is written through them must be read back through others. Empty
+files open and map nothing, windows past the end are refused. 'fuzzy batch'
+must write the column of every set for any chunk size, including windows
+not aligned to pages, an empty output for empty input and refuse input
+ending with a partial double. */
+bool test_mapped_batch(void)
+{
+    const std::string file = temporary("mapped.bin");
+    const std::size_t size = 3 * 4096 + 123;
+    {
+        MappedFile out(file, MappedFile::Mode::Write, size);
+        for (std::size_t offset = 0; offset < size; offset += 999)
+        {
+            const std::size_t n = std::min<std::size_t>(999, size - offset);
+            char *window = out.map(offset, n);
+            for (std::size_t i = 0; i < n; i++)
+                window[i] = static_cast<char>((offset + i) * 7);
+        }
+    }
+    bool passed = read_bytes(file).size() == size;
+    {
+        MappedFile in(file, MappedFile::Mode::Read);
+        passed &= in.size() == size;
+        for (std::size_t offset = 5; offset + 4000 <= size; offset += 1021)
+        {
+            const char *window = in.map(offset, 4000);
+            for (std::size_t i = 0; i < 4000; i++)
+                passed &= window[i] == static_cast<char>((offset + i) * 7);
+        }
+        try
+        {
+            in.map(size - 8, 9);
+            passed = false;
+        }
+        catch (const std::out_of_range &) {}
+    }
+    write_bytes(file, "");
+    {
+        MappedFile in(file, MappedFile::Mode::Read);
+        passed &= in.size() == 0 && in.map(0, 0) == nullptr;
+    }
+    if (!passed)
+    {
+        std::cerr << "Mapped file windows are wrong!\n";
+        return false;
+    }
+
+    const std::vector<FuzzySet> sets = shipped_sets();
+    const std::string input = temporary("mapped_input.bin");
+    const std::string output = temporary("mapped_output.bin");
+    std::vector<std::string> batch = {"batch",
+        "--model", "temperature_low.json", "--model", "temperature_high.json",
+        "--input", input, "--output", output, "--chunk", "", "--threads", "3"};
+    std::vector<double> probes = uniform(-30, 50, 10007);
+    write_bytes(input, std::string(
+        reinterpret_cast<const char*>(probes.data()),
+        probes.size() * sizeof(double)
+    ));
+    std::vector<double> expected;
+    for (const FuzzySet &set: sets)
+    {
+        std::vector<double> column = set.membership(probes);
+        expected.insert(expected.end(), column.begin(), column.end());
+    }
+    const std::string expected_bytes(
+        reinterpret_cast<const char*>(expected.data()),
+        expected.size() * sizeof(double)
+    );
+    for (std::string chunk: {"1", "3", "1000", "10007", "1048576"})
+    {
+        batch[10] = chunk;
+        const std::string error = failure(batch);
+        if (!error.empty() || read_bytes(output) != expected_bytes)
+        {
+            std::cerr << "Batch in chunks of " << chunk
+                << " gave wrong memberships " << error << "\n";
+            return false;
+        }
+    }
+
+    batch[10] = "100";
+    write_bytes(input, "");
+    std::string error = failure(batch);
+    if (!error.empty() || !std::filesystem::exists(output)
+        || std::filesystem::file_size(output) != 0)
+    {
+        std::cerr << "Batch of empty input failed " << error << "\n";
+        return false;
+    }
+    write_bytes(input, std::string(8 * 5 + 3, '\0'));
+    error = failure(batch);
+    if (error.find("partial value") == std::string::npos)
+    {
+        std::cerr << "Batch of a partial double gave '" << error << "'!\n";
+        return false;
+    }
+    return true;
+}
+
+/* 'fuzzy eval' must write the header naming the sets and a row per value
+with the memberships of every set, for numbers split by any whitespace and
+across the 1 MiB read buffer, given as text or as raw doubles. Empty input
+gives only the header, malformed input fails naming the token and line. */
+bool test_eval(void)
+{
+    const std::vector<FuzzySet> sets = shipped_sets();
+    const std::string text = temporary("eval.txt");
+    const std::string values = temporary("eval.bin");
+    const std::string output = temporary("eval.csv");
+    const std::string binary_output = temporary("eval_binary.csv");
+    const std::vector<std::string> eval = {"eval",
+        "--model", "temperature_low.json", "--model", "temperature_high.json",
+        "--input", text, "--output", output};
+    std::string header = "value";
+    for (const FuzzySet &set: sets) header += ";" + set.get_name();
+
+    // About 2.5 MB of text, so numbers are cut by the end of the buffer
+    std::vector<double> probes = uniform(-30, 50, 120000);
+    probes.insert(probes.end(), {-15, 0, -0.0, 10, 30, 1e300,
+        std::numeric_limits<double>::infinity()});
+    const char *separators[] = {" ", "\n", "\t", "\r\n", "  \n\t"};
+    std::ostringstream numbers;
+    numbers.precision(17);
+    numbers << "\n  ";
+    for (std::size_t i = 0; i < probes.size(); i++)
+        numbers << probes[i] << separators[i % 5];
+    write_bytes(text, numbers.str());
+    write_bytes(values, std::string(
+        reinterpret_cast<const char*>(probes.data()),
+        probes.size() * sizeof(double)
+    ));
+    std::vector<std::string> binary = eval;
+    binary[6] = values;
+    binary[8] = binary_output;
+    binary.push_back("--binary");
+    std::string error = failure(eval) + failure(binary);
+    if (!error.empty())
+    {
+        std::cerr << "Eval failed: " << error;
+        return false;
+    }
+
+    const std::string csv = read_bytes(output);
+    std::istringstream rows(csv);
+    std::string row;
+    std::getline(rows, row);
+    bool passed = row == header && read_bytes(binary_output) == csv;
+    for (std::size_t i = 0; passed && i < probes.size(); i++)
+    {
+        std::getline(rows, row);
+        std::istringstream cells(row);
+        std::string cell;
+        std::getline(cells, cell, ';');
+        passed = std::strtod(cell.c_str(), nullptr) == probes[i];
+        for (const FuzzySet &set: sets)
+        {
+            std::getline(cells, cell, ';');
+            passed &= std::strtod(cell.c_str(), nullptr)
+                == set.membership(probes[i]);
+        }
+    }
+    passed &= !std::getline(rows, row);
+    if (!passed)
+    {
+        std::cerr << "Eval wrote a wrong row: " << row << "\n";
+        return false;
+    }
+
+    for (std::string empty: {"", " \n\t\r\n"})
+    {
+        write_bytes(text, empty);
+        error = failure(eval);
+        if (!error.empty() || read_bytes(output) != header + "\n")
+        {
+            std::cerr << "Eval of empty input gave '" << read_bytes(output)
+                << "' " << error << "\n";
+            return false;
+        }
+    }
+
+    const std::pair<std::string, std::string> malformed[] = {
+        {"1 2\n3 abc 4\n", "'abc' on line 2"},
+        {"1\n\n2.5x\n", "'2.5x' on line 3"},
+        {"--5", "'--5' on line 1"},
+        {"1e", "'1e' on line 1"},
+        {"0x10", "'0x10' on line 1"},
+        {"1,5", "'1,5' on line 1"}
+    };
+    for (auto &m: malformed)
+    {
+        write_bytes(text, m.first);
+        error = failure(eval);
+        if (error.find("Invalid number " + m.second) == std::string::npos)
+        {
+            std::cerr << "Eval of '" << m.first << "' gave '" << error
+                << "'!\n";
+            return false;
+        }
+    }
+    write_bytes(values, std::string(12, '\0'));
+    error = failure(binary);
+    if (error.find("partial value") == std::string::npos)
+    {
+        std::cerr << "Eval of a partial double gave '" << error << "'!\n";
+        return false;
+    }
+    return true;
+}
+
+/* Every index of the range must be handed to exactly one call, in chunks
+of the requested size, with no call for an empty range, any number of
+chunks against any number of threads. An exception thrown by one chunk is
+rethrown by 'parallel_for', no chunk runs twice on the way and the pool
+keeps working. */
+bool test_thread_pool(void)
+{
+    for (unsigned threads: {1u, 3u, 16u})
+    {
+        ThreadPool pool(threads);
+        for (std::size_t count: {0, 1, 5, 1000, 100003})
+            for (std::size_t chunk: {0, 1, 7, 1000})
+            {
+                std::vector<std::atomic<int>> runs(count);
+                std::atomic<bool> misplaced{false};
+                const std::size_t size = std::max<std::size_t>(chunk, 1);
+                pool.parallel_for(count, chunk,
+                    [&](std::size_t begin, std::size_t end)
+                {
+                    if (begin % size || end <= begin || end > count
+                        || (end - begin != size && end != count))
+                        misplaced = true;
+                    for (std::size_t i = begin; i < end && end <= count; i++)
+                        runs[i]++;
+                });
+                for (std::size_t i = 0; i < count; i++)
+                    misplaced = misplaced || runs[i] != 1;
+                if (misplaced)
+                {
+                    std::cerr << "Pool of " << threads << " threads ran "
+                        << count << " tasks in chunks of " << chunk
+                        << " wrongly!\n";
+                    return false;
+                }
+            }
+
+        std::vector<std::atomic<int>> runs(1000);
+        bool thrown = false;
+        try
+        {
+            pool.parallel_for(runs.size(), 10,
+                [&](std::size_t begin, std::size_t end)
+            {
+                for (std::size_t i = begin; i < end; i++) runs[i]++;
+                if (begin == 500) throw std::runtime_error("chunk 50");
+            });
+        }
+        catch (const std::runtime_error &e)
+        {
+            thrown = std::string(e.what()) == "chunk 50";
+        }
+        for (std::atomic<int> &r: runs) thrown = thrown && r <= 1;
+        thrown = thrown && runs[500] == 1;
+        std::atomic<std::size_t> sum{0};
+        pool.parallel_for(100, 3, [&](std::size_t begin, std::size_t end)
+        {
+            sum += end - begin;
+        });
+        if (!thrown || sum != 100)
+        {
+            std::cerr << "Pool of " << threads
+                << " threads lost an exception or a task after it!\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Plot data written as .npy must load back as numpy would load it - a
+version 1.0 header padded to 64 bytes describing a float64 (n, 2) array in
+the byte order of this machine - with the same samples, bit for bit, as
+the CSV written for the same set and as 'FuzzySet::sample' gives. */
+bool test_npy(void)
+{
+    const std::uint16_t probe = 1;
+    const char order = *reinterpret_cast<const char*>(&probe) ? '<' : '>';
+    const std::string npy_file = temporary("plot.npy");
+    const std::string csv_file = temporary("plot.csv");
+    for (const FuzzySet &set: shipped_sets())
+    {
+        std::vector<double> x, y;
+        set.sample(x, y);
+        set.generate_plot_data(npy_file);
+        set.generate_plot_data(csv_file);
+        const std::string npy = read_bytes(npy_file);
+        const std::size_t length = npy.size() < 10 ? 0
+            : static_cast<unsigned char>(npy[8])
+            | static_cast<unsigned char>(npy[9]) << 8;
+        const std::string header = npy.substr(std::min<std::size_t>(
+            10, npy.size()), length);
+        const std::string shape =
+            "'shape': (" + std::to_string(x.size()) + ", 2)";
+        if (npy.compare(0, 8, std::string("\x93NUMPY\x01\x00", 8)) != 0
+            || (10 + length) % 64 != 0 || header.empty()
+            || header.back() != '\n'
+            || header.find(std::string("'descr': '") + order + "f8'")
+                == std::string::npos
+            || header.find("'fortran_order': False") == std::string::npos
+            || header.find(shape) == std::string::npos
+            || npy.size() != 10 + length + 16 * x.size())
+        {
+            std::cerr << "Header of the .npy plot of '" << set.get_name()
+                << "' is wrong: " << header << "\n";
+            return false;
+        }
+
+        std::istringstream csv(read_bytes(csv_file));
+        std::string line;
+        std::getline(csv, line);
+        for (std::size_t i = 0; i < x.size(); i++)
+        {
+            double row[2];
+            std::memcpy(row, npy.data() + 10 + length + 16 * i, 16);
+            std::getline(csv, line);
+            const std::size_t separator = line.find(';');
+            const double csv_x = std::strtod(line.c_str(), nullptr);
+            const double csv_y =
+                std::strtod(line.c_str() + separator + 1, nullptr);
+            if (std::memcmp(&row[0], &x[i], sizeof(double))
+                || std::memcmp(&row[1], &y[i], sizeof(double))
+                || csv_x != row[0] || csv_y != row[1])
+            {
+                std::cerr << "Sample " << i << " of the .npy plot of '"
+                    << set.get_name() << "' differs!\n";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/* Lines between the samples chosen by 'sample_cells' must stay within the
+tolerance of the curve everywhere in between, for every curve type. */
+bool test_sampling(void)
+{
+    std::vector<CurveVariant> curves = {
+        make_curve_variant(CurveType::Constant, {0.5}, -1, 3),
+        make_curve_variant(CurveType::Linear, {-0.25, 1}, 0, 4),
+        make_curve_variant(CurveType::Quadratic, {-1, 7, -11}, 3, 4),
+        make_curve_variant(CurveType::Quadratic, {0.02, 0, 0}, -5, 5),
+        make_curve_variant(CurveType::Exponential, {2, 1, 0, 0.1}, -2, 4),
+        make_curve_variant(CurveType::Exponential, {0.5, 0, 0.2, 1}, 0, 6),
+        make_curve_variant(CurveType::Logarithmic, {10, -1, 0}, 0, 9),
+        make_curve_variant(CurveType::Logarithmic, {2, 0, 1}, 0.5, 3)
+    };
+    for (CurveVariant &variant: curves)
+        for (double tolerance: {1e-2, 1e-4, 1e-6})
+        {
+            const Curve *curve = get_curve(variant);
+            const double from = curve->get_lower_bound();
+            const double to = curve->get_upper_bound();
+            const std::size_t cells =
+                sample_cells(curve, from, to, tolerance, 1 << 20);
+            std::vector<double> x, y;
+            sample_curve(curve, from, to, cells, x, y);
+            const bool straight = curve->get_type() == CurveType::Constant
+                || curve->get_type() == CurveType::Linear;
+            if (x.size() != cells + 1 || x.front() != from || x.back() != to
+                || (straight && cells != 1))
+            {
+                std::cerr << "Sampling gave " << x.size() << " samples on ["
+                    << from << ", " << to << "]!\n";
+                return false;
+            }
+            for (std::size_t i = 0; i < cells; i++)
+                for (int k = 1; k < 8; k++)
+                {
+                    const double t = k / 8.0;
+                    const double at = x[i] + t * (x[i + 1] - x[i]);
+                    const double line = y[i] + t * (y[i + 1] - y[i]);
+                    const double error = std::abs(line - curve->membership(at));
+                    if (error > tolerance * (1 + 1e-6) + 1e-12)
+                    {
+                        std::cerr << "Sampling error " << error << " at "
+                            << at << " exceeds " << tolerance << "!\n";
+                        return false;
+                    }
+                }
+        }
+    // The cell count is capped, including for unknown curvature
+    const Curve *quadratic = get_curve(curves[3]);
+    if (sample_cells(quadratic, -5, 5, 1e-9, 10) != 10
+        || sample_cells(quadratic, -5, 5, 0, 10) != 10)
+    {
+        std::cerr << "Sampling ignores the cell limit!\n";
+        return false;
+    }
+    return true;
+}
+
+// Big-endian 32 bit number at 'offset' of a PNG
+std::uint32_t png_uint32(const std::string &png, std::size_t offset)
+{
+    std::uint32_t value = 0;
+    for (std::size_t i = 0; i < 4; i++)
+        value = value << 8 | static_cast<unsigned char>(png[offset + i]);
+    return value;
+}
+
+/* Plots of the shipped sets: the SVG must be one svg element naming every
+set, the PNG must have the signature, chunks with valid CRCs in the order
+IHDR, IDAT, IEND, the requested size and image data holding all scanlines
+with some pixels drawn. */
+bool test_render(void)
+{
+    std::vector<FuzzySet> sets = shipped_sets();
+    const std::string svg_file = temporary("plot.svg");
+    const std::string png_file = temporary("plot.png");
+    render_plot(sets, svg_file, 320, 200);
+    render_plot(sets, png_file, 320, 200);
+
+    const std::string svg = read_bytes(svg_file);
+    bool passed = svg.rfind("<svg xmlns=\"http://www.w3.org/2000/svg\"", 0)
+        == 0 && svg.find("<svg", 1) == std::string::npos
+        && svg.find("</svg>") == svg.find_last_not_of("\n") - 5;
+    for (const FuzzySet &set: sets)
+        passed &= svg.find(">" + set.get_name() + "<") != std::string::npos;
+    if (!passed)
+    {
+        std::cerr << "SVG plot is malformed!\n";
+        return false;
+    }
+
+    const std::string png = read_bytes(png_file);
+    if (png.compare(0, 8, "\x89PNG\r\n\x1a\n") != 0)
+    {
+        std::cerr << "PNG plot has no PNG signature!\n";
+        return false;
+    }
+    std::vector<std::string> types;
+    std::string header, data;
+    for (std::size_t at = 8; at + 12 <= png.size(); )
+    {
+        const std::size_t length = png_uint32(png, at);
+        const std::string body = png.substr(at + 4, length + 4);
+        std::uint32_t crc = 0xffffffffu;
+        for (unsigned char byte: body)
+        {
+            crc ^= byte;
+            for (int k = 0; k < 8; k++)
+                crc = crc & 1 ? 0xedb88320u ^ (crc >> 1) : crc >> 1;
+        }
+        if ((crc ^ 0xffffffffu) != png_uint32(png, at + 8 + length))
+        {
+            std::cerr << "PNG chunk " << body.substr(0, 4)
+                << " has a wrong CRC!\n";
+            return false;
+        }
+        types.push_back(body.substr(0, 4));
+        if (types.back() == "IHDR") header = body.substr(4);
+        if (types.back() == "IDAT") data += body.substr(4);
+        at += length + 12;
+    }
+    if (types != std::vector<std::string>{"IHDR", "IDAT", "IEND"}
+        || header.size() != 13 || png_uint32(header, 0) != 320
+        || png_uint32(header, 4) != 200)
+    {
+        std::cerr << "PNG plot has the wrong chunks or size!\n";
+        return false;
+    }
+    // Stored deflate blocks after the 2 byte zlib header
+    std::string raw;
+    for (std::size_t at = 2; at + 5 <= data.size(); )
+    {
+        const std::size_t n = static_cast<unsigned char>(data[at + 1])
+            | static_cast<unsigned char>(data[at + 2]) << 8;
+        raw += data.substr(at + 5, n);
+        if (data[at] & 1) break;
+        at += 5 + n;
+    }
+    const std::size_t drawn = std::count_if(raw.begin(), raw.end(),
+        [](char c) {return c != '\0' && c != '\xff';});
+    if (raw.size() != (3 * 320 + 1) * 200 || drawn == 0)
+    {
+        std::cerr << "PNG plot has " << raw.size() << " bytes of image data"
+            << " and " << drawn << " drawn!\n";
+        return false;
+    }
+    return true;
+}
+
+bool test_instrumentation(void)
+{
+    std::vector<FuzzySet> sets = shipped_sets();
+    if (!instrumentation_report(sets)["enabled"]) return true;
+    FuzzySet empty;
+    std::vector<double> probes = uniform(-30, 50, 1000);
+    std::vector<double> output(probes.size());
+    json before = instrumentation_report(sets)["membership"];
+    for (double x: probes) sink = sets[0].membership(x);
+    sets[0].membership(probes.data(), output.data(), probes.size());
+    sink = empty.membership(0);
+    json after = instrumentation_report(sets)["membership"];
+    const std::uint64_t calls = after["calls"].get<std::uint64_t>()
+        - before["calls"].get<std::uint64_t>();
+    const std::uint64_t values = after["values"].get<std::uint64_t>()
+        - before["values"].get<std::uint64_t>();
+    const std::uint64_t outside = after["outside"].get<std::uint64_t>()
+        - before["outside"].get<std::uint64_t>();
+    if (calls != probes.size() + 2 || values != 2 * probes.size() + 1
+        || outside != 1)
+    {
+        std::cerr << "Instrumentation counted " << calls << " calls, "
+            << values << " values and " << outside << " outside!\n";
+        return false;
+    }
+    /* Sets made one after another likely reuse the address of the curve
+    before, each must still report only its own evaluations. */
+    for (std::size_t n = 1; n <= 4; n++)
+    {
+        std::vector<FuzzySet> fresh = {FuzzySet("Fresh", json::parse(
+            R"([{"ConstantCurve": {"bounds": {"lower": 0, "upper": 1,
+                "lower_inclusive": true}, "value": 1}}])"))};
+        for (std::size_t i = 0; i < n; i++) sink = fresh[0].membership(0.5);
+        json curves = instrumentation_report(fresh)["curves"];
+        if (curves.size() != 1 || curves[0]["evaluations"] != n)
+        {
+            std::cerr << "Instrumentation reported " << curves.dump()
+                << " after " << n << " evaluations!\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Triangle rising from 'left' to 1 at 'peak' and falling to 'right'
+FuzzySet triangle(
+    const std::string &name, double left, double peak, double right
+)
+{
+    const double up = 1 / (peak - left), down = 1 / (peak - right);
+    json rising = {
+        {"bounds", {{"lower", left}, {"upper", peak},
+            {"lower_inclusive", true}, {"upper_inclusive", true}}},
+        {"slope", up}, {"intercept", -left * up}
+    };
+    json falling = {
+        {"bounds", {{"lower", peak}, {"upper", right},
+            {"upper_inclusive", true}}},
+        {"slope", down}, {"intercept", -right * down}
+    };
+    json curves = json::array();
+    curves.push_back({{"LinearCurve", rising}});
+    curves.push_back({{"LinearCurve", falling}});
+    return FuzzySet(name, curves);
+}
+
+// Shipped temperature sets and a humidity variable in percent
+std::vector<LinguisticVariable> rule_inputs(void)
+{
+    return {
+        LinguisticVariable("temperature", shipped_sets(), -30, 50),
+        LinguisticVariable("humidity", {
+            triangle("Dry", -1, 0, 60), triangle("Humid", 40, 100, 101)
+        }, 0, 100)
+    };
+}
+
+/* Rules with their firing strength computed directly from the set
+memberships, 'm' maps set names of both inputs to memberships. Rules with
+NOT or OR have no guard term and must fire even where their terms are 0. */
+typedef struct test_rule
+{
+    Condition condition;
+    std::function<double(std::map<std::string, double> &m)> strength;
+    std::string consequent;
+} TestRule;
+
+std::vector<TestRule> test_rules(void)
+{
+    auto is = [](const std::string &set)
+    {
+        const bool humidity = set == "Dry" || set == "Humid";
+        return Condition::is(humidity ? "humidity" : "temperature", set);
+    };
+    typedef std::map<std::string, double> M;
+    return {
+        {is("Cold") & is("Humid"),
+            [](M &m) {return std::min(m["Cold"], m["Humid"]);}, "High"},
+        {is("Dry") & is("Warm") & is("OK"),
+            [](M &m) {return std::min({m["Dry"], m["Warm"], m["OK"]});},
+            "Low"},
+        {!is("Hot"), [](M &m) {return 1 - m["Hot"];}, "Low"},
+        {is("Freezing") | is("Dry"),
+            [](M &m) {return std::max(m["Freezing"], m["Dry"]);}, "High"},
+        {!(is("Warm") | is("Humid")) & is("OK"),
+            [](M &m)
+            {
+                return std::min(1 - std::max(m["Warm"], m["Humid"]), m["OK"]);
+            }, "Low"},
+        {is("Hot"), [](M &m) {return m["Hot"];}, "High"}
+    };
+}
+
+// Input rows over both universes, breakpoints of the temperature included
+std::vector<double> rule_probes(void)
+{
+    std::vector<double> temperatures = uniform(-30, 50, 500);
+    for (double x: {-15.0, 0.0, 5.0, 10.0, 15.0, 20.0, 25.0, 30.0})
+        temperatures.push_back(x);
+    std::vector<double> humidities = uniform(0, 100, temperatures.size());
+    std::vector<double> rows;
+    for (std::size_t i = 0; i < temperatures.size(); i++)
+    {
+        rows.push_back(temperatures[i]);
+        rows.push_back(humidities[i]);
+    }
+    return rows;
+}
+
+/* Rules indexed by their guard term must fire exactly when their strength
+is non-zero, once each and with the strength of the condition. */
+bool test_rules_fire(void)
+{
+    std::vector<LinguisticVariable> inputs = rule_inputs();
+    std::vector<TestRule> rules = test_rules();
+    RuleBase base(inputs);
+    for (const TestRule &rule: rules) base.add(rule.condition);
+    std::vector<double> rows = rule_probes();
+    std::vector<double> terms(base.term_count()), stack;
+    for (std::size_t row = 0; row < rows.size() / 2; row++)
+    {
+        const double *in = &rows[2 * row];
+        std::map<std::string, double> m;
+        for (std::size_t v = 0; v < inputs.size(); v++)
+            for (const FuzzySet &set: inputs[v].get_sets())
+                m[set.get_name()] = set.membership(in[v]);
+        std::vector<double> fired(rules.size(), 0);
+        std::vector<int> calls(rules.size(), 0);
+        base.fuzzify(in, terms.data());
+        base.fire(terms.data(), stack, [&](std::size_t r, double strength)
+        {
+            fired[r] = strength;
+            calls[r]++;
+        });
+        for (std::size_t r = 0; r < rules.size(); r++)
+        {
+            // Rules that don't fire leave 'fired' at 0
+            const double strength = rules[r].strength(m);
+            const double expected = strength > 0 ? strength : 0;
+            if (fired[r] != expected || calls[r] != (expected > 0))
+            {
+                std::cerr << "Rule " << r << " fired " << calls[r]
+                    << " times with " << fired[r] << " instead of "
+                    << expected << " at (" << in[0] << ", " << in[1]
+                    << ")!\n";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/* Mamdani output must be the centroid of the clipped and aggregated
+consequents, NaN when no rule fires or the fired sets are zero, and the
+same with the rows split between threads. */
+bool test_mamdani(void)
+{
+    std::vector<LinguisticVariable> inputs = rule_inputs();
+    LinguisticVariable power("power", {
+        triangle("Low", -1, 0, 60), triangle("High", 40, 100, 101),
+        triangle("Never", 200, 300, 400)
+    }, 0, 100);
+    std::vector<TestRule> rules = test_rules();
+    const std::size_t resolution = 201;
+    MamdaniEngine engine(inputs, {power}, resolution);
+    for (const TestRule &rule: rules)
+        engine.add_rule(rule.condition, "power", rule.consequent);
+
+    std::vector<double> rows = rule_probes();
+    const std::size_t count = rows.size() / 2;
+    std::vector<double> serial(count), threaded(count);
+    engine.infer(rows.data(), count, serial.data());
+    for (std::size_t row = 0; row < count; row++)
+    {
+        std::map<std::string, double> m;
+        for (std::size_t v = 0; v < inputs.size(); v++)
+            for (const FuzzySet &set: inputs[v].get_sets())
+                m[set.get_name()] = set.membership(rows[2 * row + v]);
+        std::map<std::string, double> clip;
+        for (const TestRule &rule: rules)
+            clip[rule.consequent] =
+                std::max(clip[rule.consequent], rule.strength(m));
+        double area = 0, moment = 0;
+        for (std::size_t k = 0; k < resolution; k++)
+        {
+            const double z = 100.0 * k / (resolution - 1);
+            double level = 0;
+            for (const FuzzySet &set: power.get_sets())
+                level = std::max(level,
+                    std::min(clip[set.get_name()], set.membership(z)));
+            area += level;
+            moment += level * z;
+        }
+        const double expected = moment / area;
+        if (!(std::fabs(serial[row] - expected) < 1e-9))
+        {
+            std::cerr << "Mamdani gave " << serial[row] << " instead of "
+                << expected << " at (" << rows[2 * row] << ", "
+                << rows[2 * row + 1] << ")!\n";
+            return false;
+        }
+    }
+
+    ThreadPool pool(4);
+    engine.infer(rows.data(), count, threaded.data(), pool, 7);
+    if (std::memcmp(serial.data(), threaded.data(), count * sizeof(double)))
+    {
+        std::cerr << "Threaded Mamdani output differs!\n";
+        return false;
+    }
+
+    // At 0 degrees Hot is 0 and Cold is 1, Never is 0 on the whole universe
+    for (auto method: {MamdaniEngine::Defuzzification::Centroid,
+        MamdaniEngine::Defuzzification::MeanOfMaximum})
+    {
+        MamdaniEngine silent(inputs, {power}, resolution, method);
+        silent.add_rule(Condition::is("temperature", "Hot"), "power", "High");
+        silent.add_rule(Condition::is("temperature", "Cold"), "power", "Never");
+        if (!std::isnan(silent.infer({0, 50})[0]))
+        {
+            std::cerr << "Mamdani without a non-zero consequent gave "
+                << silent.infer({0, 50})[0] << "!\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Sugeno output must be the average of the rule consequents weighted by
+firing strength, rules without a guard term included, NaN when no rule
+fires, and the same with the rows split between threads. */
+bool test_sugeno(void)
+{
+    std::vector<LinguisticVariable> inputs = rule_inputs();
+    std::vector<TestRule> rules = test_rules();
+    SugenoEngine engine(inputs);
+    for (std::size_t r = 0; r < rules.size(); r++)
+        engine.add_rule(rules[r].condition, {0.5 * r, -0.25}, 10.0 * r);
+
+    std::vector<double> rows = rule_probes();
+    const std::size_t count = rows.size() / 2;
+    std::vector<double> serial(count), threaded(count);
+    engine.infer(rows.data(), count, serial.data());
+    for (std::size_t row = 0; row < count; row++)
+    {
+        const double *in = &rows[2 * row];
+        std::map<std::string, double> m;
+        for (std::size_t v = 0; v < inputs.size(); v++)
+            for (const FuzzySet &set: inputs[v].get_sets())
+                m[set.get_name()] = set.membership(in[v]);
+        double weights = 0, sum = 0;
+        for (std::size_t r = 0; r < rules.size(); r++)
+        {
+            const double strength = rules[r].strength(m);
+            if (!(strength > 0)) continue;
+            weights += strength;
+            sum += strength * (10.0 * r + 0.5 * r * in[0] - 0.25 * in[1]);
+        }
+        const double expected = sum / weights;
+        if (!(std::fabs(serial[row] - expected) < 1e-9))
+        {
+            std::cerr << "Sugeno gave " << serial[row] << " instead of "
+                << expected << " at (" << in[0] << ", " << in[1] << ")!\n";
+            return false;
+        }
+    }
+
+    ThreadPool pool(4);
+    engine.infer(rows.data(), count, threaded.data(), pool, 7);
+    if (std::memcmp(serial.data(), threaded.data(), count * sizeof(double)))
+    {
+        std::cerr << "Threaded Sugeno output differs!\n";
+        return false;
+    }
+
+    // Hot is 0 at 0 degrees, the only rule can't fire
+    SugenoEngine silent(inputs);
+    silent.add_rule(Condition::is("temperature", "Hot"), 1);
+    if (!std::isnan(silent.infer({0, 50})))
+    {
+        std::cerr << "Sugeno without a fired rule gave "
+            << silent.infer({0, 50}) << "!\n";
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const std::map<std::string, std::function<bool(void)>> tests = {
+        {"static_sets", test_static_sets},
+        {"batch", test_batch},
+        {"segment_index", test_segment_index},
+        {"compiled", test_compiled},
+        {"codegen", test_codegen},
+        {"binary_model", test_binary_model},
+        {"binary_commands", test_binary_commands},
+        {"algebra", test_algebra},
+        {"optional_parameters", test_optional_parameters},
+        {"moments", test_moments},
+        {"variable", test_variable},
+        {"lut", test_lut},
+        {"instrumentation", test_instrumentation},
+        {"render", test_render},
+        {"sampling", test_sampling},
+        {"npy", test_npy},
+        {"thread_pool", test_thread_pool},
+        {"eval", test_eval},
+        {"mapped_batch", test_mapped_batch},
+        {"plot_export", test_plot_export},
+        {"rules", test_rules_fire},
+        {"mamdani", test_mamdani},
+        {"sugeno", test_sugeno}
+    };
+    std::vector<std::string> names;
+    for (int i = 1; i < argc; i++) names.push_back(argv[i]);
+    if (names.empty())
+        for (auto &test: tests) names.push_back(test.first);
+
+    bool passed = true;
+    for (std::string name: names)
+    {
+        auto test = tests.find(name);
+        if (test == tests.end())
+        {
+            std::cerr << "Unknown test '" << name << "'!\n";
+            passed = false;
+            continue;
+        }
+        try
+        {
+            if (test->second()) continue;
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+        }
+        std::cerr << "Test '" << name << "' failed!\n";
+        passed = false;
+    }
+    return passed ? 0 : 1;
+}
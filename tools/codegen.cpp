@@ -0,0 +1,46 @@
+/* Build-time generator of specialized evaluation functions.
+Usage: codegen [--fast] <model.json> <output.hpp> [namespace]
+With '--fast' the functions use std::fma and precomputed logarithms and
+match the interpreter up to rounding instead of bit for bit. */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "../include/fuzzy.h"
+#include "../include/codegen.h"
+
+int main(int argc, char **argv)
+{
+    const bool fast = argc > 1 && std::string(argv[1]) == "--fast";
+    if (fast)
+    {
+        argc--;
+        argv++;
+    }
+    if (argc < 3 || argc > 4)
+    {
+        std::cerr << "Usage: codegen [--fast] <model.json> <output.hpp> "
+            "[namespace]\n";
+        return 2;
+    }
+    try
+    {
+        std::vector<FuzzySet> sets = load_fuzzy_sets(argv[1]);
+        std::string name_space = argc == 4 ? argv[3] : "";
+        std::ofstream output_file(argv[2], std::ios::trunc);
+        if (!output_file.good())
+        {
+            std::string message = "File " + std::string(argv[2])
+                + " can't be oppened!";
+            throw std::invalid_argument(message);
+        }
+        output_file << generate_header(sets, argv[1], name_space, fast);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}